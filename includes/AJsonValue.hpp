@@ -15,11 +15,26 @@ typedef enum json_type {
 
 class JsonObject;
 class JsonArray;
+class JsonString;
+class JsonDocument;
 
 class AJsonValue {
+private:
+  json_type type_;
+  bool arenaOwned_;
+
+  friend class JsonDocument;
+
+protected:
+  AJsonValue(json_type);
+  AJsonValue(const AJsonValue &);
+
 public:
   typedef void (AJsonValue::*bool_type)() const;
+  AJsonValue &operator=(const AJsonValue &);
   virtual ~AJsonValue();
+  static void release(AJsonValue *);
+  bool isArenaOwned() const;
   json_type getType() const;
   void print() const;
   double asDouble() const;
@@ -30,6 +45,7 @@ public:
   JsonObject &asRefObject() const;
   JsonArray *asArray() const;
   JsonArray &asRefArray() const;
+  JsonString *asJsonString() const;
   bool isArray() const;
   bool isObject() const;
   bool isNumber() const;
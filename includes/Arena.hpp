@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+
+// Bump allocator handing out memory from a list of chunks. Individual
+// allocations are never freed; everything goes away at once when the arena
+// is reset or destroyed, in O(chunks). rewind() instead keeps every chunk
+// aside, in O(1), and grow() takes them back before calling malloc, so an
+// arena reused for similar documents stops allocating. mallocs() counts the
+// chunks ever taken from malloc, reused ones excluded.
+class Arena {
+private:
+  struct Chunk {
+    Chunk *next;
+    size_t size;
+  };
+
+  Chunk *head_;
+  Chunk *tail_;
+  Chunk *free_;
+  char *cur_;
+  char *end_;
+  size_t chunkSize_;
+  size_t chunks_;
+  size_t mallocs_;
+  size_t used_;
+
+  Arena(const Arena &);
+  Arena &operator=(const Arena &);
+  void *grow(size_t size);
+  Chunk *reuse(size_t size);
+  static void releaseChunks(Chunk *chunk);
+
+public:
+  static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+  static const size_t ALIGNMENT = 2 * sizeof(void *);
+
+  Arena(size_t chunkSize = DEFAULT_CHUNK_SIZE);
+  ~Arena();
+  void *allocate(size_t size);
+  char *copy(const char *data, size_t length);
+  void reset();
+  void rewind();
+  size_t chunks() const;
+  size_t mallocs() const;
+  size_t used() const;
+};
+
+inline void *Arena::allocate(size_t size) {
+  size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+  if (static_cast<size_t>(end_ - cur_) < size)
+    return grow(size);
+  void *ptr = cur_;
+  cur_ += size;
+  used_ += size;
+  return ptr;
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include "AJsonValue.hpp"
+#include "JsonHandler.hpp"
+#include "JsonKey.hpp"
+#include "JsonValidator.hpp"
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+struct JsonValue;
+
+// A validator tree lowered into one flat array of instructions, run by a
+// small interpreter. The properties of an object are resolved to slots
+// through a hash table built at compile time, so an object is walked once
+// whatever the number of properties; messages are formatted up front and
+// paths are only rendered for the errors actually reported. The errors are
+// those the tree would report, in the same order, but defaults are never
+// applied: as on a JsonValue, a missing field that has one is accepted.
+// The program does not depend on the tree it was compiled from and is only
+// read by validate(), so one instance can serve many threads. Validators of
+// a class it does not know are kept as clones and run through their own
+// validate().
+class CompiledSchema {
+private:
+  enum op_code { OP_TYPE, OP_OBJECT, OP_MATCH, OP_ARRAY, OP_OR,
+                 OP_STRING, OP_NUMBER, OP_BOOL, OP_CALL };
+
+  enum op_flag {
+    F_OPTIONAL = 1,    // may be missing or null in its object
+    F_DEFAULT = 2,     // has a default, which also makes it optional
+    F_NOT_EMPTY = 4,   // object with at least one member
+    F_CLOSED = 8,      // object without additional properties
+    F_MIN = 16,        // string or number lower bound
+    F_MAX = 32,        // string or number upper bound
+    F_MESSAGE = 64     // OR with a message of its own
+  };
+
+  // `message` is the first of the formatted messages of the instruction: the
+  // prefix of its type error, or for an OR the error of having no branch;
+  // the others follow in the order they are checked. `first` and `count`
+  // select properties_ for an object, conditions_ for an OR and checks_ for
+  // a string.
+  struct Instruction {
+    unsigned char op;
+    unsigned char flags;
+    json_type type;   // exceptedType_ of the validator, for OR branches
+    unsigned first;
+    unsigned count;
+    unsigned child;   // array items, match keys
+    unsigned value;   // match values
+    unsigned slots;   // object: its table in slots_, of mask + 1 entries
+    unsigned mask;
+    unsigned message;
+    size_t lower;     // array size or string length bounds
+    size_t upper;
+    long min;         // number bounds
+    long max;
+  };
+
+  struct Property {
+    JsonKey key;
+    unsigned node;
+  };
+
+  struct StringCheck {
+    bool (*func)(const JsonString &);
+    IChecker *checker;
+    unsigned message;
+  };
+
+  std::vector<Instruction> program_;
+  std::vector<Property> properties_;
+  std::vector<unsigned> slots_;
+  std::vector<unsigned> conditions_;
+  std::vector<StringCheck> checks_;
+  std::vector<std::string> messages_;
+  std::vector<AJsonValidator *> calls_;
+
+  friend class SchemaHandler;
+
+  CompiledSchema(const CompiledSchema &);
+  CompiledSchema &operator=(const CompiledSchema &);
+
+  unsigned lower(const AJsonValidator &);
+  unsigned message(const std::string &);
+  void table(Instruction &ins);
+  unsigned slot(const Instruction &ins, const char *key, size_t length,
+                size_t hash) const;
+  void fail(std::vector<ValidationError> &errors, const SchemaPath &path,
+            unsigned message) const;
+  bool checkType(const Instruction &ins, json_type expected, json_type got,
+                 std::vector<ValidationError> &errors,
+                 const SchemaPath &path) const;
+  bool checkString(const Instruction &ins, const JsonString &s,
+                   std::vector<ValidationError> &errors,
+                   const SchemaPath &path) const;
+  template <typename Node>
+  bool run(unsigned pc, const Node &v, ErrorSink &errors,
+           const SchemaPath &path) const;
+  template <typename Node>
+  bool object(const Instruction &ins, const Node &v, ErrorSink &errors,
+              const SchemaPath &path) const;
+  template <typename Node>
+  bool match(const Instruction &ins, const Node &v, ErrorSink &errors,
+             const SchemaPath &path) const;
+  template <typename Node>
+  bool check(const Node &v, std::vector<ValidationError> &errors,
+             const ValidateOptions &options, const std::string &path) const;
+  template <typename Node>
+  bool any(const Instruction &ins, const Node &v, ErrorSink &errors,
+           const SchemaPath &path) const;
+
+public:
+  CompiledSchema();
+  explicit CompiledSchema(const AJsonValidator &);
+  ~CompiledSchema();
+  void compile(const AJsonValidator &);
+  bool validate(const AJsonValue *, std::vector<ValidationError> &errors,
+                const std::string &path = "") const;
+  bool validate(const JsonValue *, std::vector<ValidationError> &errors,
+                const std::string &path = "") const;
+  bool validate(const AJsonValue *, std::vector<ValidationError> &errors,
+                const ValidateOptions &options,
+                const std::string &path = "") const;
+  bool validate(const JsonValue *, std::vector<ValidationError> &errors,
+                const ValidateOptions &options,
+                const std::string &path = "") const;
+  size_t size() const;
+  void clear();
+};
+
+// Validates a document while it is parsed: handed to Json::sax() or to a
+// JsonPushParser, it runs the program of a CompiledSchema on the events
+// without building the document. Objects and arrays buffer the errors of
+// their members so that they come out in the order of the tree; only the
+// values an OR or a validator of an unknown class is applied to are built,
+// as AJsonValue subtrees keeping the members in input order. With
+// `failFast`, the first violation stops the parse: the callback returns
+// false and getErrors() holds what was found so far, possibly on a value a
+// repeated key would have replaced: otherwise a repeated key counts once,
+// with its last value, as on the tree. One handler checks one document;
+// clear() readies it for another.
+class SchemaHandler : public JsonHandler {
+private:
+  typedef CompiledSchema::Instruction Instruction;
+
+  // An object, match or array being checked. `path` points into the frame
+  // below, which the deque keeps in place.
+  struct Frame {
+    unsigned pc;
+    SchemaPath path;
+    std::string key;   // current member
+    unsigned property; // its index in properties_, NONE for another key;
+                       // for a match, its slot in found
+    size_t size;       // members or elements so far
+    std::vector<char> seen;
+    std::vector<std::vector<ValidationError> > found; // per property or key
+    std::vector<ValidationError> errors; // items or extra keys
+    std::map<std::string, unsigned> keys; // slots of a match, extra keys
+  };
+
+  const CompiledSchema &schema_;
+  bool failFast_;
+  std::string root_;
+  std::deque<Frame> frames_;
+  size_t depth_;    // frames in use
+  size_t skipping_; // depth inside a value nothing checks
+  size_t building_; // depth inside a value being built
+  unsigned buildPc_;
+  SchemaPath buildPath_;
+  JsonTreeBuilder builder_;
+  std::vector<ValidationError> errors_;
+
+  SchemaHandler(const SchemaHandler &);
+  SchemaHandler &operator=(const SchemaHandler &);
+
+  Frame &top();
+  SchemaPath here() const;
+  std::vector<ValidationError> &destination();
+  bool expect(unsigned &pc);
+  bool report(bool ok);
+  bool check(unsigned pc, const AJsonValue &value,
+             std::vector<ValidationError> &errors, const SchemaPath &path);
+  bool scalar(const AJsonValue &value);
+  bool open(json_type type);
+  bool close();
+  bool built();
+  void flush();
+
+public:
+  SchemaHandler(const CompiledSchema &schema, bool failFast = false);
+  bool valid() const;
+  const std::vector<ValidationError> &getErrors() const;
+  void clear();
+
+  bool onObjectStart();
+  bool onKey(const std::string &key);
+  bool onObjectEnd();
+  bool onArrayStart();
+  bool onArrayEnd();
+  bool onString(const std::string &value);
+  bool onNumber(long value);
+  bool onDouble(double value);
+  bool onBool(bool value);
+  bool onNull();
+};
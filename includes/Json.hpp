@@ -1,11 +1,108 @@
 #pragma once
 
 #include "AJsonValue.hpp"
+#include "JsonMembers.hpp"
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+class Arena;
+class JsonDocument;
+class JsonHandler;
+class KeyPool;
+struct ParseBuffers;
+class StructuralIndex;
+struct JsonValue;
+
+// TOKEN_ENGINE reads the input one token at a time. STRUCTURAL_ENGINE
+// first indexes every structural character with vector instructions, then
+// builds the same tree from the index; it pays off on large documents.
+enum parse_engine { TOKEN_ENGINE, STRUCTURAL_ENGINE };
+
+// Parse failure located in the input, thrown by the tree, compact and lazy
+// parsers. `offset` is the position of the token being read when the error
+// was found, `line` and `column` (1-based, columns counted in bytes) are
+// worked out from it only once the parse has failed. what() is unchanged.
+class ParseError : public std::runtime_error {
+private:
+  size_t offset_;
+  size_t line_;
+  size_t column_;
+
+public:
+  ParseError(const std::string &message, const char *begin, size_t offset);
+  size_t offset() const;
+  size_t line() const;
+  size_t column() const;
+};
+
+// Filled by a tree parse when ParseOptions::stats points to it. `nodes` is
+// indexed by json_type; `maxDepth` is the deepest container nesting, 1 for a
+// flat root. `allocations` counts the allocations made for the nodes: one per
+// node on the heap, one per arena chunk a JsonDocument takes from malloc
+// (chunks reused from an earlier parse are free); the buffers of strings and
+// containers are not counted. STRUCTURAL_ENGINE spends
+// `indexSeconds` building the structural index; `buildSeconds` is the time
+// spent tokenizing and building the tree. After a failed parse only the
+// counts up to the error are set.
+struct ParseStats {
+  size_t bytes;
+  size_t nodes[UNDEFINED];
+  size_t maxDepth;
+  size_t allocations;
+  double indexSeconds;
+  double buildSeconds;
+
+  ParseStats();
+  void clear();
+  size_t totalNodes() const;
+};
+
+// With stringViews, strings without escapes are not copied: their
+// JsonString points into the input, which must then outlive the tree.
+// JsonDocument::parseFile() keeps the file for as long as the tree;
+// Json::parseFile() cannot, and ignores the flag.
+// maxDepth bounds the nesting of objects and arrays; deeper input is
+// rejected with "Maximum nesting depth exceeded!". Counting into `stats`
+// costs a test per node when it is NULL, the default.
+struct ParseOptions {
+  static const size_t DEFAULT_MAX_DEPTH = 1024;
+
+  key_order keyOrder;
+  parse_engine engine;
+  bool stringViews;
+  size_t maxDepth;
+  ParseStats *stats;
+
+  ParseOptions();
+};
 
 class Json {
 public:
   static AJsonValue *parse(std::string);
+  static AJsonValue *parseFile(const std::string &);
+  static AJsonValue *parseFile(const std::string &, const ParseOptions &);
   static AJsonValue *parse_raw(std::string);
+  static AJsonValue *parse_raw(const char *, size_t);
+  static AJsonValue *parse_raw(const char *, size_t, JsonDocument *);
+  static AJsonValue *parse_raw(const char *, size_t, const ParseOptions &,
+                               JsonDocument * = NULL);
+  // Same, with scratch storage kept by the caller (see JsonParser).
+  static AJsonValue *parse_raw(const char *, size_t, const ParseOptions &,
+                               JsonDocument *, ParseBuffers &);
+  // Builds the value starting at entry `entry` of an index of [begin, end).
+  // `following` receives the entry of the token after the value.
+  static AJsonValue *parse_indexed(const char *begin, const char *end,
+                                   const StructuralIndex &index, size_t entry,
+                                   const ParseOptions &options,
+                                   JsonDocument *doc = NULL,
+                                   size_t *following = NULL);
+  static bool sax(const char *, size_t, JsonHandler &);
+  static bool sax(const std::string &, JsonHandler &);
+  static bool saxFile(const std::string &, JsonHandler &);
+  static JsonValue
+  parse_compact(const char *, size_t, Arena &, KeyPool * = NULL,
+                size_t maxDepth = ParseOptions::DEFAULT_MAX_DEPTH);
 };
 
 std::string match_json_name(json_type type);
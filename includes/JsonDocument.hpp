@@ -0,0 +1,90 @@
+#pragma once
+
+#include "AJsonValue.hpp"
+#include "Arena.hpp"
+#include "Json.hpp"
+#include "JsonKey.hpp"
+#include "JsonValue.hpp"
+#include <new>
+#include <string>
+#include <vector>
+
+// Owns every node of one parse. Nodes made by the parser through create()
+// live in the document's arena: tearing the tree down runs the destructors
+// but never frees nodes one by one, and the chunks are released in one go.
+// The root must not be deleted by the caller.
+// parseCompact() builds the JsonValue representation instead, which lives in
+// the arena entirely and needs no destructor at all.
+// Member keys are interned in a per-document KeyPool: each distinct key is
+// stored once and compared by pointer.
+// parseFile() with ParseOptions::stringViews keeps the file mapped until the
+// next parse or clear(), as the strings of the tree point into it.
+// parseParallel() splits a top-level array at its elements with a
+// structural pre-scan and builds them on `threads` worker threads (0 means
+// one per online CPU), each into a document of its own that this one keeps
+// until the next parse or clear(). The root array is then stitched together
+// in input order. Any other root, and any malformed input, is parsed again
+// by parse() on the calling thread, so errors are the ones parse() reports.
+class MappedFile;
+
+class JsonDocument {
+private:
+  Arena arena_;
+  KeyPool keys_;
+  AJsonValue *root_;
+  JsonValue value_;
+  MappedFile *file_;
+  std::vector<JsonDocument *> parts_;
+
+  JsonDocument(const JsonDocument &);
+  JsonDocument &operator=(const JsonDocument &);
+
+public:
+  JsonDocument(size_t chunkSize = Arena::DEFAULT_CHUNK_SIZE);
+  ~JsonDocument();
+  AJsonValue *parse(const std::string &raw,
+                    const ParseOptions &options = ParseOptions());
+  AJsonValue *parse(const char *data, size_t length,
+                    const ParseOptions &options = ParseOptions());
+  AJsonValue *parseFile(const std::string &filename,
+                        const ParseOptions &options = ParseOptions());
+  AJsonValue *parseParallel(const char *data, size_t length,
+                            const ParseOptions &options = ParseOptions(),
+                            size_t threads = 0);
+  AJsonValue *parseParallelFile(const std::string &filename,
+                                const ParseOptions &options = ParseOptions(),
+                                size_t threads = 0);
+  AJsonValue *root() const;
+  const JsonValue &
+  parseCompact(const std::string &raw,
+               size_t maxDepth = ParseOptions::DEFAULT_MAX_DEPTH);
+  const JsonValue &
+  parseCompact(const char *data, size_t length,
+               size_t maxDepth = ParseOptions::DEFAULT_MAX_DEPTH);
+  const JsonValue &
+  parseCompactFile(const std::string &filename,
+                   size_t maxDepth = ParseOptions::DEFAULT_MAX_DEPTH);
+  const JsonValue &value() const;
+  Arena &arena();
+  KeyPool &keys();
+  void clear(bool keepMemory = false);
+
+  template <typename T> T *create() {
+    T *node = new (arena_.allocate(sizeof(T))) T();
+    node->arenaOwned_ = true;
+    return node;
+  }
+
+  template <typename T, typename A> T *create(const A &arg) {
+    T *node = new (arena_.allocate(sizeof(T))) T(arg);
+    node->arenaOwned_ = true;
+    return node;
+  }
+
+  template <typename T, typename A, typename B>
+  T *create(const A &a, const B &b) {
+    T *node = new (arena_.allocate(sizeof(T))) T(a, b);
+    node->arenaOwned_ = true;
+    return node;
+  }
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "AJsonValue.hpp"
+#include "JsonMembers.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Receiver of the events emitted by Json::sax() and JsonPushParser. Every
+// callback does nothing by default; returning false from one stops the
+// parse. Strings passed to onKey() and onString() are only valid for the
+// duration of the call. Events are emitted as the input is read, so a
+// malformed document may deliver some events before the parse throws.
+class JsonHandler {
+public:
+  virtual ~JsonHandler();
+  virtual bool onObjectStart();
+  virtual bool onKey(const std::string &key);
+  virtual bool onObjectEnd();
+  virtual bool onArrayStart();
+  virtual bool onArrayEnd();
+  virtual bool onString(const std::string &value);
+  virtual bool onNumber(long value);
+  virtual bool onDouble(double value);
+  virtual bool onBool(bool value);
+  virtual bool onNull();
+};
+
+// Builds the AJsonValue tree from the events. onValue() is called for every
+// value once it is complete, already attached to its parent, so a subclass
+// can pick up fragments (say, each element of a huge top-level array) while
+// the rest of the input is still on its way. The tree is deleted with the
+// builder unless release() takes it.
+class JsonTreeBuilder : public JsonHandler {
+private:
+  std::vector<AJsonValue *> open_;
+  std::string key_;
+  AJsonValue *root_;
+  key_order order_;
+
+  JsonTreeBuilder(const JsonTreeBuilder &);
+  JsonTreeBuilder &operator=(const JsonTreeBuilder &);
+  bool add(AJsonValue *value);
+  bool end();
+
+protected:
+  virtual bool onValue(AJsonValue *value, size_t depth);
+
+public:
+  JsonTreeBuilder(key_order order = SORTED_KEYS);
+  ~JsonTreeBuilder();
+  AJsonValue *root() const;
+  AJsonValue *release();
+  void clear();
+
+  bool onObjectStart();
+  bool onKey(const std::string &key);
+  bool onObjectEnd();
+  bool onArrayStart();
+  bool onArrayEnd();
+  bool onString(const std::string &value);
+  bool onNumber(long value);
+  bool onDouble(double value);
+  bool onBool(bool value);
+  bool onNull();
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Object member key. A key either owns its text or is a handle to an entry
+// of a KeyPool, in which case every occurrence of that key in the document
+// shares the same entry and equality is a pointer comparison. Both kinds
+// carry the hash of their text, computed once.
+class JsonKey {
+public:
+  struct Entry {
+    std::string text;
+    size_t hash;
+  };
+
+private:
+  std::string text_;
+  const Entry *entry_;
+  size_t hash_;
+
+public:
+  JsonKey();
+  explicit JsonKey(const std::string &);
+  JsonKey(const char *, size_t);
+  explicit JsonKey(const Entry *);
+  JsonKey(const JsonKey &);
+  JsonKey &operator=(const JsonKey &);
+  void swap(JsonKey &);
+
+  const std::string &str() const;
+  operator const std::string &() const;
+  const char *data() const;
+  size_t size() const;
+  size_t hash() const;
+  bool isInterned() const;
+  bool operator==(const JsonKey &) const;
+  bool operator!=(const JsonKey &) const;
+  bool operator<(const JsonKey &) const;
+
+  static size_t hash(const char *data, size_t length);
+};
+
+bool operator==(const JsonKey &, const std::string &);
+bool operator!=(const JsonKey &, const std::string &);
+std::ostream &operator<<(std::ostream &, const JsonKey &);
+
+// Interning table of one document. The pool owns its entries; clear(true)
+// keeps them, with the capacity of their strings, and the next document
+// overwrites them in turn, so a pool reused for similar documents stops
+// allocating.
+class KeyPool {
+private:
+  std::deque<JsonKey::Entry> entries_; // the first count_ are in use
+  std::vector<JsonKey::Entry *> slots_;
+  size_t count_;
+
+  KeyPool(const KeyPool &);
+  KeyPool &operator=(const KeyPool &);
+  void grow();
+
+public:
+  KeyPool();
+  ~KeyPool();
+  JsonKey intern(const char *data, size_t length);
+  size_t size() const;
+  void clear(bool keepSlots = false);
+};
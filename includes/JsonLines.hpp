@@ -0,0 +1,38 @@
+#pragma once
+
+#include "JsonValidator.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Outcome of one record of a JSON Lines (NDJSON) input. A record that does
+// not parse is invalid with a single error carrying the parse message.
+struct LineResult {
+  size_t line; // 1-based line number in the input
+  bool valid;
+  std::vector<ValidationError> errors;
+
+  LineResult();
+};
+
+// JSON Lines support: one document per line, blank lines ignored.
+// validate() parses and checks the records on `threads` worker threads
+// (0 means one per online CPU), which all share `schema`: validation only
+// reads it. Results come back in input order.
+class JsonLines {
+public:
+  struct Line {
+    const char *data;
+    size_t length;
+    size_t number;
+  };
+
+  static void split(const char *data, size_t length, std::vector<Line> &lines);
+  static void validate(const char *data, size_t length,
+                       const AJsonValidator &schema,
+                       std::vector<LineResult> &results, size_t threads = 0);
+  static void validateFile(const std::string &filename,
+                           const AJsonValidator &schema,
+                           std::vector<LineResult> &results,
+                           size_t threads = 0);
+};
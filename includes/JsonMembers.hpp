@@ -0,0 +1,64 @@
+#pragma once
+
+#include "JsonKey.hpp"
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+class AJsonValue;
+
+typedef enum key_order { SORTED_KEYS, INSERTION_ORDER } key_order;
+
+// Contiguous member storage for JsonObject, with the subset of the std::map
+// interface the object model uses. Entries sit in one vector, iterated either
+// by key (SORTED_KEYS, the std::map order) or in insertion order. Small
+// objects are searched directly in the vector (binary search when sorted);
+// past INDEX_THRESHOLD entries an open-addressing index over the hashes
+// cached in the keys is kept next to it.
+// Parsers append() the members in input order instead and finish() the
+// object once it is complete: in sorted mode the members are then sorted,
+// deduplicated and indexed in one go. Until then only iteration is valid.
+class JsonMembers {
+public:
+  typedef std::pair<JsonKey, AJsonValue *> value_type;
+  typedef std::vector<value_type>::iterator iterator;
+  typedef std::vector<value_type>::const_iterator const_iterator;
+
+  static const size_t INDEX_THRESHOLD = 32;
+
+private:
+  std::vector<value_type> entries_;
+  std::vector<size_t> index_;
+  key_order order_;
+  bool pending_; // appended members not yet put in order
+
+  size_t locate(const JsonKey &key, size_t &hint) const;
+  size_t insertAt(size_t pos, const JsonKey &key);
+  void reserveFor(size_t count);
+  void rebuildIndex();
+  void indexEntry(size_t pos);
+  void shiftIndex(size_t pos);
+
+public:
+  JsonMembers(key_order order = SORTED_KEYS);
+  JsonMembers(const JsonMembers &);
+  JsonMembers &operator=(const JsonMembers &);
+
+  key_order order() const;
+  size_t size() const;
+  bool empty() const;
+  iterator begin();
+  const_iterator begin() const;
+  iterator end();
+  const_iterator end() const;
+  iterator find(const std::string &key);
+  const_iterator find(const std::string &key) const;
+  iterator find(const JsonKey &key);
+  const_iterator find(const JsonKey &key) const;
+  AJsonValue *&operator[](const std::string &key);
+  AJsonValue *&operator[](const JsonKey &key);
+  AJsonValue *append(const JsonKey &key, AJsonValue *value);
+  void finish(std::vector<AJsonValue *> &replaced);
+  void clear();
+};
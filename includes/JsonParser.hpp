@@ -0,0 +1,47 @@
+#pragma once
+
+#include "AJsonValue.hpp"
+#include "Json.hpp"
+#include "JsonDocument.hpp"
+#include "StructuralIndex.hpp"
+#include "parser.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Scratch storage of the tree parsers: the current token and the capacity
+// of its text, the stack of open containers and the structural index.
+struct ParseBuffers {
+  token tk;
+  std::vector<AJsonValue *> open;
+  StructuralIndex index;
+};
+
+// Parser kept across many documents. Its buffers keep their capacity from
+// one parse to the next, and so does its document: the arena is rewound and
+// the key table emptied, keeping its entries and their strings, rather than
+// freed. Once it has seen a document as
+// large as the current one the parser itself stops allocating; only the
+// nodes still allocate their own member, element and string storage.
+// The tree returned by parse() lives until the next parse() or clear().
+// Given a document, parse() builds there instead, or on the heap for NULL
+// (the caller then deletes the root), and still reuses the buffers.
+class JsonParser {
+private:
+  ParseOptions options_;
+  ParseBuffers buffers_;
+  JsonDocument doc_;
+  AJsonValue *root_;
+
+  JsonParser(const JsonParser &);
+  JsonParser &operator=(const JsonParser &);
+
+public:
+  JsonParser(const ParseOptions &options = ParseOptions());
+  ~JsonParser();
+  AJsonValue *parse(const char *data, size_t length);
+  AJsonValue *parse(const std::string &raw);
+  AJsonValue *parse(const char *data, size_t length, JsonDocument *doc);
+  ParseOptions &options();
+  void clear();
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Json.hpp"
+#include "parser.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class JsonHandler;
+
+// Resumable parser fed with arbitrary chunks of one document. Events reach
+// the handler as soon as the token completing them has arrived; a token cut
+// by a chunk boundary (inside a string, an escape, a number or a literal) is
+// kept aside, and only tokenized once the chunk completing it has arrived.
+// Nothing else is buffered.
+// feed() and finish() return false once a callback has stopped the parse
+// and throw on malformed input, after which only reset() is meaningful.
+// Nesting deeper than maxDepth is rejected like malformed input.
+class JsonPushParser {
+private:
+  enum state {
+    ROOT,          // nothing read yet
+    VALUE,         // after ':'
+    FIRST_ELEMENT, // after '['
+    ELEMENT,       // after ',' in an array
+    FIRST_KEY,     // after '{'
+    KEY,           // after ',' in an object
+    AFTER_KEY,     // after a key
+    NEXT,          // after a value inside a container
+    DONE           // after the root value
+  };
+
+  JsonHandler &handler_;
+  std::vector<token_type> open_;
+  std::string pending_;
+  token tk_;
+  state state_;
+  size_t maxDepth_;
+  bool stopped_;
+  bool ended_;
+
+  JsonPushParser(const JsonPushParser &);
+  JsonPushParser &operator=(const JsonPushParser &);
+
+  size_t continuation(const char *data, size_t length, bool &complete) const;
+  bool consume(const char *begin, const char *end, bool last);
+  bool push(const token &tk);
+  bool value(const token &tk);
+  bool close(const token &tk);
+
+public:
+  JsonPushParser(JsonHandler &handler,
+                 size_t maxDepth = ParseOptions::DEFAULT_MAX_DEPTH);
+  bool feed(const char *data, size_t length);
+  bool feed(const std::string &chunk);
+  bool finish();
+  bool done() const;
+  void reset();
+};
@@ -1,9 +1,9 @@
 #pragma once
 
 #include "AJsonValue.hpp"
+#include "JsonMembers.hpp"
 
 #include <cstdlib>
-#include <map>
 #include <string>
 #include <vector>
 
@@ -35,6 +35,7 @@ class JsonDouble : public AJsonValue {
 public:
   JsonDouble();
   double value;
+  JsonDouble(double);
   JsonDouble(std::string);
   JsonDouble(const JsonDouble &);
   AJsonValue *clone() const;
@@ -52,13 +53,25 @@ public:
   bool isEqual(AJsonValue &other);
 };
 
+// The text is either owned, in `value`, or a view into the parsed input made
+// with ParseOptions::stringViews, in which case `value` is empty. data() and
+// size() read both kinds without copying. Copies always own their text.
 class JsonString : public AJsonValue {
+private:
+  const char *view_;
+  size_t viewLength_;
+
 public:
   std::string value;
 
   JsonString();
   JsonString(std::string);
+  JsonString(const char *data, size_t length);
   JsonString(const JsonString &);
+  bool isView() const;
+  const char *data() const;
+  size_t size() const;
+  std::string str() const;
   AJsonValue *clone() const;
   bool isEqual(const AJsonValue &other) const;
   bool isEqual(AJsonValue &other);
@@ -66,15 +79,20 @@ public:
 
 class JsonObject : public AJsonValue {
 public:
-  typedef std::map<std::string, AJsonValue *> container;
+  typedef JsonMembers container;
   typedef container::iterator iterator;
   typedef container::const_iterator const_iterator;
   container members;
 
   JsonObject();
+  JsonObject(key_order);
   JsonObject(const JsonObject &);
+  key_order order() const;
   void setProperty(const std::string &key, AJsonValue *value);
+  void setProperty(const JsonKey &key, AJsonValue *value);
   void replaceProperty(const std::string &key, AJsonValue *value);
+  void appendProperty(const JsonKey &key, AJsonValue *value);
+  void finishProperties();
   size_t size() const;
   iterator begin();
   const_iterator begin() const;
@@ -6,6 +6,8 @@
 #include <map>
 #include <string>
 
+struct JsonValue;
+
 class ValidationError {
 public:
   std::string path;
@@ -14,17 +16,67 @@ public:
   ValidationError(const std::string &, const std::string &);
 };
 
+// Path of the value being checked, kept on the stack as a chain of segments
+// and only turned into a string for an error. A ROOT segment holds the path
+// passed to validate().
+struct SchemaPath {
+  enum kind { ROOT, PROPERTY, MATCH, ITEM, SIZE };
+
+  kind what;
+  const SchemaPath *parent;
+  const std::string *root;
+  const char *name;
+  size_t length; // of the name, or index of the item
+
+  static SchemaPath start(const std::string &path);
+  SchemaPath child(kind segment, const char *key, size_t size) const;
+  std::string str() const;
+};
+
+// Per-call limits of validate(). Validation stops as soon as maxErrors
+// errors are collected, 0 (the default) collecting them all; 1 is fail-fast,
+// for callers that only need to know whether the value is valid, which does
+// not depend on the limit. The errors kept are the first ones of the full
+// list, except that an OR compares its branches on no more errors than it
+// may report, and keeps the first of those that reach the limit.
+struct ValidateOptions {
+  size_t maxErrors;
+
+  ValidateOptions();
+};
+
+// Where one validation puts its errors: the list of the caller, and the size
+// of the list at which the validation stops.
+struct ErrorSink {
+  std::vector<ValidationError> &list;
+  size_t limit;
+
+  bool full() const { return list.size() >= limit; }
+  void add(const SchemaPath &path, const std::string &msg);
+};
+
+// A validator is only read by the validate() overloads taking an error list,
+// so one schema can check documents on several threads at once. The others
+// keep the errors in the validator for getErrors(), and may not overlap.
+// Classes defined outside this file that only override the latter are run
+// on a clone for each call, which keeps the shared schema untouched but
+// costs a copy of the validator; overriding validateAt() avoids it.
+// Only the overloads taking a non-const AJsonValue fill in the defaults of
+// the schema (see applyDefaults()), before validating the value; the others
+// never write to it, and accept a missing field that has a default.
 class AJsonValidator {
 public:
   typedef std::vector<ValidationError> ValidationErr;
 
 protected:
-  ValidationErr errors_;
+  ValidationErr errors_; // of the calls without an error list
   bool optional_;
   bool hasDefault_;
   json_type exceptedType_;
   AJsonValue *defaultValue_;
 
+  friend class CompiledSchema;
+
 public:
   AJsonValidator();
   AJsonValidator(const AJsonValidator &);
@@ -32,32 +84,73 @@ public:
   void clearErrors();
   virtual ~AJsonValidator();
   virtual bool validate(const AJsonValue *, const std::string &path = "") = 0;
+  virtual bool validate(const JsonValue *, const std::string &path = "") = 0;
   virtual AJsonValidator *clone() const = 0;
+  bool validate(AJsonValue *, const std::string &path = "");
+  bool validate(AJsonValue *, const ValidateOptions &,
+                const std::string &path = "");
+  bool validate(const AJsonValue *, const ValidateOptions &,
+                const std::string &path = "");
+  bool validate(const JsonValue *, const ValidateOptions &,
+                const std::string &path = "");
+  bool validate(const AJsonValue *, ValidationErr &errors,
+                const std::string &path = "") const;
+  bool validate(const JsonValue *, ValidationErr &errors,
+                const std::string &path = "") const;
+  bool validate(const AJsonValue *, ValidationErr &errors,
+                const ValidateOptions &, const std::string &path = "") const;
+  bool validate(const JsonValue *, ValidationErr &errors,
+                const ValidateOptions &, const std::string &path = "") const;
   void set_optional();
   bool get_optional() const;
   bool isTypeCompatible(const AJsonValidator &, const AJsonValue *v) const;
+  bool isTypeCompatible(const AJsonValidator &, const JsonValue *v) const;
   virtual AJsonValue *get_default() const;
   bool has_default() const;
   void set_default(AJsonValue *);
   virtual AJsonValue *applyDefaults(AJsonValue *);
 
 protected:
+  // What every validate() runs, the path only rendered for an error. By
+  // default a clone renders it and runs validate(), so that a validator only
+  // has to override validate(); the built-in ones override both, and so must
+  // their subclasses. An override adds its errors to `errors` and returns
+  // as soon as errors.full(), as the clone cannot.
+  virtual bool validateAt(const AJsonValue &, const SchemaPath &path,
+                          ErrorSink &errors) const;
+  virtual bool validateAt(const JsonValue &, const SchemaPath &path,
+                          ErrorSink &errors) const;
   void addError(const std::string &, const std::string &);
+  template <typename Node>
+  bool runChild(const AJsonValidator &child, const Node &v,
+                const SchemaPath &path, ErrorSink &errors) const;
 };
 
 class TypeValidator : public AJsonValidator {
+private:
+  template <typename Node>
+  bool validateNode(const Node &, const SchemaPath &path,
+                    ErrorSink &errors) const;
+
+protected:
+  bool validateAt(const AJsonValue &, const SchemaPath &path,
+                  ErrorSink &errors) const;
+  bool validateAt(const JsonValue &, const SchemaPath &path,
+                  ErrorSink &errors) const;
 
 public:
+  using AJsonValidator::validate;
   TypeValidator(json_type);
   AJsonValidator *clone() const;
   bool validate(const AJsonValue *, const std::string &path = "");
+  bool validate(const JsonValue *, const std::string &path = "");
 };
 
 class StringValidator;
 
 class ObjectValidator : public AJsonValidator {
 private:
-  typedef std::map<std::string, AJsonValidator *> ValidatorMap;
+  typedef std::map<JsonKey, AJsonValidator *> ValidatorMap;
   typedef ValidatorMap::iterator iterator;
   typedef ValidatorMap::const_iterator const_iterator;
 
@@ -69,7 +162,20 @@ private:
   AJsonValidator *val_validator;
   AJsonValidator *last_;
 
+  friend class CompiledSchema;
+
+  template <typename Node>
+  bool validateNode(const Node &, const SchemaPath &path,
+                    ErrorSink &errors) const;
+
+protected:
+  bool validateAt(const AJsonValue &, const SchemaPath &path,
+                  ErrorSink &errors) const;
+  bool validateAt(const JsonValue &, const SchemaPath &path,
+                  ErrorSink &errors) const;
+
 public:
+  using AJsonValidator::validate;
   ObjectValidator();
   ObjectValidator(const ObjectValidator &);
   ObjectValidator &property(const std::string &name, const AJsonValidator &v);
@@ -78,6 +184,7 @@ public:
   ObjectValidator &optional();
   ObjectValidator &notEmpty();
   bool validate(const AJsonValue *, const std::string &path = "");
+  bool validate(const JsonValue *, const std::string &path = "");
   AJsonValidator *clone() const;
   ObjectValidator &withDefault(JsonObject &v);
   AJsonValue *applyDefaults(AJsonValue *);
@@ -91,11 +198,25 @@ private:
   size_t max_;
   JsonArray *defaultValue_;
 
+  friend class CompiledSchema;
+
+  template <typename Node>
+  bool validateNode(const Node &, const SchemaPath &path,
+                    ErrorSink &errors) const;
+
+protected:
+  bool validateAt(const AJsonValue &, const SchemaPath &path,
+                  ErrorSink &errors) const;
+  bool validateAt(const JsonValue &, const SchemaPath &path,
+                  ErrorSink &errors) const;
+
 public:
+  using AJsonValidator::validate;
   ArrayValidator();
   ArrayValidator(const ArrayValidator &);
   ArrayValidator &optional();
   bool validate(const AJsonValue *, const std::string &path = "");
+  bool validate(const JsonValue *, const std::string &path = "");
   ArrayValidator &min(size_t);
   ArrayValidator &max(size_t);
   ArrayValidator &item(const AJsonValidator &v);
@@ -111,12 +232,26 @@ private:
   std::vector<AJsonValidator *> conditions_;
   std::string msg_;
 
+  friend class CompiledSchema;
+
+  template <typename Node>
+  bool validateNode(const Node &, const SchemaPath &path,
+                    ErrorSink &errors) const;
+
+protected:
+  bool validateAt(const AJsonValue &, const SchemaPath &path,
+                  ErrorSink &errors) const;
+  bool validateAt(const JsonValue &, const SchemaPath &path,
+                  ErrorSink &errors) const;
+
 public:
+  using AJsonValidator::validate;
   ORValidator();
   ORValidator(const ORValidator &);
   ORValidator &addConditions(const AJsonValidator &v);
   ORValidator &withMsg(const std::string &msg);
   bool validate(const AJsonValue *, const std::string &path = "");
+  bool validate(const JsonValue *, const std::string &path = "");
   AJsonValidator *clone() const;
   ~ORValidator();
 };
@@ -137,7 +272,20 @@ private:
   std::map<std::string, funcCheck> checkers;
   std::string defaultValue_;
 
+  friend class CompiledSchema;
+
+  template <typename Node>
+  bool validateNode(const Node &, const SchemaPath &path,
+                    ErrorSink &errors) const;
+
+protected:
+  bool validateAt(const AJsonValue &, const SchemaPath &path,
+                  ErrorSink &errors) const;
+  bool validateAt(const JsonValue &, const SchemaPath &path,
+                  ErrorSink &errors) const;
+
 public:
+  using AJsonValidator::validate;
   StringValidator();
   StringValidator(const StringValidator &);
   AJsonValidator *clone() const;
@@ -156,6 +304,7 @@ public:
   StringValidator &notEmpty();
   StringValidator &optional();
   bool validate(const AJsonValue *, const std::string &path = "");
+  bool validate(const JsonValue *, const std::string &path = "");
   AJsonValue *get_default() const;
   StringValidator &withDefault(const std::string);
   ~StringValidator();
@@ -169,7 +318,20 @@ private:
   bool checkMax;
   long defaultValue_;
 
+  friend class CompiledSchema;
+
+  template <typename Node>
+  bool validateNode(const Node &, const SchemaPath &path,
+                    ErrorSink &errors) const;
+
+protected:
+  bool validateAt(const AJsonValue &, const SchemaPath &path,
+                  ErrorSink &errors) const;
+  bool validateAt(const JsonValue &, const SchemaPath &path,
+                  ErrorSink &errors) const;
+
 public:
+  using AJsonValidator::validate;
   NumberValidator();
   NumberValidator(const NumberValidator &);
   AJsonValidator *clone() const;
@@ -179,18 +341,31 @@ public:
   NumberValidator &range(long);
   NumberValidator &optional();
   bool validate(const AJsonValue *, const std::string &path = "");
+  bool validate(const JsonValue *, const std::string &path = "");
   AJsonValue *get_default() const;
   NumberValidator &withDefault(long);
   ~NumberValidator();
 };
 
 class BoolValidator : public AJsonValidator {
+private:
+  template <typename Node>
+  bool validateNode(const Node &, const SchemaPath &path,
+                    ErrorSink &errors) const;
+
+protected:
+  bool validateAt(const AJsonValue &, const SchemaPath &path,
+                  ErrorSink &errors) const;
+  bool validateAt(const JsonValue &, const SchemaPath &path,
+                  ErrorSink &errors) const;
 
 public:
+  using AJsonValidator::validate;
   BoolValidator();
   BoolValidator(const BoolValidator &);
   BoolValidator &optional();
   bool validate(const AJsonValue *, const std::string &path = "");
+  bool validate(const JsonValue *, const std::string &path = "");
   AJsonValue *get_default() const;
   AJsonValidator *clone() const;
   BoolValidator &withDefault(bool);
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "AJsonValue.hpp"
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+class Arena;
+struct JsonMember;
+
+// Compact, 16-byte alternative to the AJsonValue hierarchy. Scalars are
+// stored inline; strings, arrays and objects point to storage in the Arena
+// they were parsed into, so a JsonValue is only valid while that arena is.
+// It is a POD: copying one is a shallow copy and nothing needs destroying.
+// Lengths are 32-bit: the parser rejects a longer string, key, array or
+// object with a ParseError.
+struct JsonValue {
+  typedef void (JsonValue::*bool_type)() const;
+
+  union {
+    bool boolean;
+    long number;
+    double real;
+    const char *string;
+    const JsonValue *elements;
+    const JsonMember *members;
+  } u;
+  unsigned int length;
+  json_type type;
+
+  json_type getType() const;
+  bool isArray() const;
+  bool isObject() const;
+  bool isNumber() const;
+  bool isString() const;
+  bool isDouble() const;
+  bool isNull() const;
+  bool isBool() const;
+  bool asBool() const;
+  long asNumber() const;
+  double asDouble() const;
+  std::string asString() const;
+  const char *data() const;
+  size_t size() const;
+  const JsonValue *find(const char *key, size_t keyLength) const;
+  const JsonValue &operator[](const std::string &) const;
+  const JsonValue &operator[](const unsigned long &) const;
+  const JsonValue &at(const std::string &) const;
+  const JsonValue &at(const unsigned long &) const;
+  const JsonMember *begin() const;
+  const JsonMember *end() const;
+  operator bool_type() const;
+  void dummy() const;
+  AJsonValue *toTree() const;
+
+  static JsonValue null();
+};
+
+struct JsonMember {
+  const char *key;
+  unsigned int keyLength;
+  JsonValue value;
+};
+
+typedef char json_value_is_16_bytes[sizeof(JsonValue) <= 16 ? 1 : -1];
+
+std::ostream &printJson(std::ostream &os, const JsonValue &v,
+                        unsigned indent = 0);
+std::ostream &operator<<(std::ostream &, const JsonValue &);
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "AJsonValue.hpp"
+#include "Json.hpp"
+#include "JsonDocument.hpp"
+#include "StructuralIndex.hpp"
+#include "parser.hpp"
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+class LazyDocument;
+class MappedFile;
+
+// Handle on one value of a LazyDocument, read straight from the index. A
+// missing key or index gives an empty handle, which behaves as null and
+// tests false. Scalars are decoded on every call; get() builds the subtree
+// as AJsonValue nodes, once, for the code that needs a tree. size() counts
+// the members of an object as written, duplicate keys included. Handles are
+// only valid as long as the document is neither cleared nor reparsed.
+// size() and an index walk the container from its start, so a loop over
+// the items should go forward instead: first() is the first element of an
+// array or the value of the first member of an object, next() the item
+// after it, in O(1) each, and key() the key of a member, as written.
+//   for (LazyValue item = list.first(); item; item = item.next())
+class LazyValue {
+private:
+  const LazyDocument *doc_;
+  size_t entry_;
+  size_t close_; // of the container the value was reached from, or npos
+
+  LazyValue(const LazyDocument *doc, size_t entry, size_t close);
+  LazyValue item(size_t entry, size_t close) const;
+
+public:
+  typedef void (LazyValue::*bool_type)() const;
+
+  LazyValue();
+  LazyValue(const LazyDocument *doc, size_t entry);
+  json_type getType() const;
+  bool isObject() const;
+  bool isArray() const;
+  bool isString() const;
+  bool isNumber() const;
+  bool isDouble() const;
+  bool isBool() const;
+  bool isNull() const;
+  size_t size() const;
+  LazyValue operator[](const std::string &) const;
+  LazyValue operator[](const unsigned long &) const;
+  LazyValue at(const std::string &) const;
+  LazyValue at(const unsigned long &) const;
+  LazyValue first() const;
+  LazyValue next() const;
+  std::string key() const;
+  std::string asString() const;
+  long asNumber() const;
+  double asDouble() const;
+  bool asBool() const;
+  AJsonValue *get() const;
+  operator bool_type() const;
+  void dummy() const;
+};
+
+// On-demand access to a document: parse() only builds the structural index
+// and pairs up the brackets, so a lookup jumps over the values it is not
+// after without reading them. Only the bracket structure is checked up
+// front; the grammar of a value is checked when it is read or built, so a
+// malformed member may go unnoticed until it is touched. The input must
+// outlive the document unless it was passed as a std::string or a file.
+// Subtrees built by LazyValue::get() live in the document; ParseOptions::stats
+// is not cleared between them, it adds up the nodes of every subtree built.
+class LazyDocument {
+private:
+  const char *begin_;
+  const char *end_;
+  std::string buffer_;
+  MappedFile *file_;
+  StructuralIndex index_;
+  std::vector<unsigned int> match_; // closing entry of each '{' and '['
+  ParseOptions options_;
+  mutable JsonDocument nodes_;
+  mutable std::map<size_t, AJsonValue *> built_;
+
+  friend class LazyValue;
+
+  LazyDocument(const LazyDocument &);
+  LazyDocument &operator=(const LazyDocument &);
+
+  void index(const char *data, size_t length);
+  void pair(const char *data, size_t length);
+  char at(size_t entry) const;
+  size_t skip(size_t entry) const;
+  size_t first(size_t entry) const;
+  size_t next(size_t entry, size_t close) const;
+  bool keyEquals(size_t entry, const std::string &key) const;
+  void read(size_t entry, token &tk) const;
+  void malformed(size_t entry) const;
+  AJsonValue *build(size_t entry) const;
+
+public:
+  LazyDocument();
+  ~LazyDocument();
+  LazyValue parse(const char *data, size_t length,
+                  const ParseOptions &options = ParseOptions());
+  LazyValue parse(const std::string &raw,
+                  const ParseOptions &options = ParseOptions());
+  LazyValue parseFile(const std::string &filename,
+                      const ParseOptions &options = ParseOptions());
+  LazyValue root() const;
+  void clear();
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// First stage of the structural parser: the offsets, in document order, of
+// every byte a value or punctuation starts at. That is each of {}[]:, and
+// each opening quote outside strings, plus the first byte of every other
+// run of non-whitespace (numbers, literals and stray bytes). The input is
+// classified 64 bytes at a time with classify_block(); escapes and string
+// interiors are resolved with bit arithmetic on the masks.
+class StructuralIndex {
+private:
+  std::vector<unsigned int> positions_;
+
+public:
+  // Largest input build() accepts, as offsets are stored on 32 bits.
+  static const size_t MAX_LENGTH = 0xffffffffu;
+
+  void build(const char *begin, const char *end);
+  void clear();
+
+  size_t size() const { return positions_.size(); }
+  unsigned int operator[](size_t i) const { return positions_[i]; }
+};
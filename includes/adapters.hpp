@@ -0,0 +1,92 @@
+#pragma once
+
+#include "AJsonValue.hpp"
+#include "JsonKey.hpp"
+#include "JsonTypes.hpp"
+#include "JsonValue.hpp"
+#include <cstddef>
+#include <string>
+
+// Adapters letting the validators walk both value representations, the
+// AJsonValue tree and the compact JsonValue, through one implementation.
+inline size_t node_size(const AJsonValue &v) {
+  if (v.isObject())
+    return v.asObject()->size();
+  if (v.isArray())
+    return v.asArray()->size();
+  return 0;
+}
+
+inline size_t node_size(const JsonValue &v) { return v.size(); }
+
+inline const AJsonValue &node_at(const AJsonValue &v, size_t idx) {
+  return *v.asArray()->elements[idx];
+}
+
+inline const JsonValue &node_at(const JsonValue &v, size_t idx) {
+  return v.u.elements[idx];
+}
+
+inline size_t string_length(const AJsonValue &v) {
+  return static_cast<const JsonString &>(v).size();
+}
+
+inline size_t string_length(const JsonValue &v) { return v.size(); }
+
+inline const JsonString &as_json_string(const AJsonValue &v, JsonString &) {
+  return static_cast<const JsonString &>(v);
+}
+
+inline const JsonString &as_json_string(const JsonValue &v, JsonString &tmp) {
+  tmp = JsonString(v.data(), v.size());
+  return tmp;
+}
+
+// Property names are JsonKeys with their hash computed once, so looking one
+// up in an object compares hashes before comparing text.
+inline const AJsonValue *find_member(const AJsonValue &v, const JsonKey &key) {
+  const JsonObject *obj = v.asObject();
+  JsonObject::const_iterator it = obj->members.find(key);
+  return it == obj->end() ? NULL : it->second;
+}
+
+inline const JsonValue *find_member(const JsonValue &v, const JsonKey &key) {
+  return v.find(key.data(), key.size());
+}
+
+template <typename Node> class MemberCursor;
+
+template <> class MemberCursor<AJsonValue> {
+private:
+  JsonObject::const_iterator it_;
+  JsonObject::const_iterator end_;
+
+public:
+  MemberCursor(const AJsonValue &v)
+      : it_(v.asObject()->begin()), end_(v.asObject()->end()) {}
+  bool done() const { return it_ == end_; }
+  const std::string &key() const { return it_->first.str(); }
+  const JsonKey &handle() const { return it_->first; }
+  const char *keyData() const { return it_->first.data(); }
+  size_t keyLength() const { return it_->first.size(); }
+  size_t keyHash() const { return it_->first.hash(); }
+  const AJsonValue &value() const { return *it_->second; }
+  void next() { ++it_; }
+};
+
+template <> class MemberCursor<JsonValue> {
+private:
+  const JsonMember *it_;
+  const JsonMember *end_;
+
+public:
+  MemberCursor(const JsonValue &v) : it_(v.begin()), end_(v.end()) {}
+  bool done() const { return it_ == end_; }
+  std::string key() const { return std::string(it_->key, it_->keyLength); }
+  JsonKey handle() const { return JsonKey(it_->key, it_->keyLength); }
+  const char *keyData() const { return it_->key; }
+  size_t keyLength() const { return it_->keyLength; }
+  size_t keyHash() const { return JsonKey::hash(it_->key, it_->keyLength); }
+  const JsonValue &value() const { return it_->value; }
+  void next() { ++it_; }
+};
@@ -1,7 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <ostream>
 #include <string>
-#include <vector>
 
 typedef enum token_type {
   CB_OPEN,
@@ -19,20 +20,41 @@ typedef enum token_type {
   TK_UNDEFINED
 } t_type;
 
+// Number tokens carry their value in `number` (TK_NUMBER) or `real`
+// (TK_DOUBLE), converted while scanning; their text is not kept.
+// A tokenizer in view mode leaves the text of a TK_STRING without escapes in
+// the input: `view` points at it and `token` stays empty. `view` is NULL for
+// every other string. `offset` is the position of the first byte of the
+// token in the input (the end of the input for END).
 typedef struct token {
   std::string token;
   t_type type;
+  long number;
+  double real;
+  const char *view;
+  size_t viewLength;
+  size_t offset;
 } token;
 
+// Scans a contiguous, caller-owned byte range. The range must outlive the
+// tokenizer; nothing is copied except the text of string and number tokens.
 class Tokenizer {
-public:
-  static token extract_token(std::istream &);
-  static void parse(std::istream &, std::vector<token> &);
-};
+private:
+  const char *begin_;
+  const char *cur_;
+  const char *end_;
+  bool views_;
+
+  void extract_string(token &);
+  void extract_decimal(token &);
+  void extract_json_types(token &);
 
-class Lexer {
 public:
-  static std::vector<token> &parse(std::vector<token> &);
+  Tokenizer(const char *begin, const char *end, bool views = false);
+  void next(token &);
+  token extract_token();
+  size_t offset() const;
+  void seek(size_t offset);
 };
 
 std::ostream &operator<<(std::ostream &os, token &tk);
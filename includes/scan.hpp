@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+// Byte scanning kernels used by the Tokenizer and the StructuralIndex. On
+// x86 they look at 16 (SSE2) or 32 (AVX2) bytes at a time; the widest
+// variant the CPU supports is picked once, on first use from any thread,
+// with a plain byte loop as fallback.
+
+// First byte of [p, end) that isspace() would reject, or end.
+const char *skip_whitespace(const char *p, const char *end);
+
+// First '"' or '\\' in [p, end), or end.
+const char *find_string_special(const char *p, const char *end);
+
+// Bit i of each mask describes byte i of a 64-byte block.
+struct BlockMasks {
+  uint64_t quote;
+  uint64_t backslash;
+  uint64_t space;
+  uint64_t op; // one of {}[]:,
+};
+
+// Classifies the 64 bytes at `block`, which must all be readable.
+void classify_block(const char *block, BlockMasks &masks);
@@ -7,6 +7,7 @@
 
 void split(std::vector<std::string> &buff, const std::string &s, char deli);
 std::string perm_to_string(int);
+double monotonic_seconds();
 
 #ifndef SIZE_T_MAX
 #define SIZE_T_MAX ((size_t)(-1))
@@ -35,3 +36,24 @@ public:
   bool hasPermissions(bool read, bool write, bool exec);
   static bool remove_directory(const std::string &path);
 };
+
+// Read-only view of a whole file. The file is mmap'ed when possible,
+// otherwise it is read() into a single owned buffer.
+class MappedFile {
+private:
+  const char *data_;
+  size_t size_;
+  bool mapped_;
+  std::string buffer_;
+
+  MappedFile(const MappedFile &);
+  MappedFile &operator=(const MappedFile &);
+  void readAll(int fd, size_t sizeHint);
+
+public:
+  MappedFile(const std::string &path);
+  ~MappedFile();
+  const char *data() const;
+  size_t size() const;
+  bool isMapped() const;
+};
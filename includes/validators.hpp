@@ -23,10 +23,9 @@ struct isStartWith_ : public IChecker {
   isStartWith_(char c) : c(c) {}
 
   bool operator()(const JsonString &str) const {
-    const std::string &value = str.value;
-    if (value.empty())
+    if (!str.size())
       return false;
-    if (value[0] == c)
+    if (str.data()[0] == c)
       return true;
     return false;
   }
@@ -37,7 +36,9 @@ struct isEqual_ : public IChecker {
   std::string value;
   isEqual_(const std::string &v) : value(v) {}
 
-  bool operator()(const JsonString &str) const { return str.value == value; }
+  bool operator()(const JsonString &str) const {
+    return value.compare(0, std::string::npos, str.data(), str.size()) == 0;
+  }
   IChecker *clone() const { return new isEqual_(*this); }
 };
 
@@ -45,7 +46,7 @@ struct isFileWithPermissions_ : public IChecker {
   int permissions;
   isFileWithPermissions_(int perms) : permissions(perms) {}
   bool operator()(const JsonString &str) const {
-    const std::string &value = str.value;
+    const std::string value = str.str();
     if (value.empty())
       return false;
     FileInfo file(value);
@@ -66,7 +67,7 @@ struct isDirWithPermissions_ : public IChecker {
   int permissions;
   isDirWithPermissions_(int perms) : permissions(perms) {}
   bool operator()(const JsonString &str) const {
-    const std::string &value = str.value;
+    const std::string value = str.str();
     if (value.empty())
       return false;
     FileInfo file(value);
@@ -1,16 +1,43 @@
 #include "Json.hpp"
+#include "JsonLines.hpp"
 #include "JsonValidator.hpp"
 #include "schema.hpp"
+#include <cstring>
 #include <iostream>
 
-int main() {
-  AJsonValue *config = Json::parse("config.json");
+static void print_errors(const std::vector<ValidationError> &errors,
+                         const std::string &prefix) {
+  for (size_t i = 0; i < errors.size(); ++i)
+    std::cout << prefix << errors[i].path << ": " << errors[i].msg
+              << std::endl;
+}
 
-  if (!ServerSchema.validate(config)) {
-    const std::vector<ValidationError> &errors = ServerSchema.getErrors();
-    for (size_t i = 0; i < errors.size(); ++i) {
-      std::cout << errors[i].path << ": " << errors[i].msg << std::endl;
+// ./json_validator [--lines] [file]: validates `file` (config.json by
+// default) against ServerSchema; with --lines, every line of it separately.
+int main(int argc, char **argv) {
+  bool lines = argc > 1 && std::strcmp(argv[1], "--lines") == 0;
+  const char *filename = argc > 1 + lines ? argv[1 + lines] : "config.json";
+
+  if (lines) {
+    std::vector<LineResult> results;
+    size_t invalid = 0;
+    JsonLines::validateFile(filename, ServerSchema, results);
+    for (size_t i = 0; i < results.size(); ++i) {
+      if (results[i].valid)
+        continue;
+      invalid++;
+      print_errors(results[i].errors,
+                   "line " + to_string(results[i].line) + ": ");
     }
+    std::cout << results.size() - invalid << "/" << results.size()
+              << " records valid" << std::endl;
+    return invalid != 0;
+  }
+
+  AJsonValue *config = Json::parse(filename);
+
+  if (!ServerSchema.validate(config)) {
+    print_errors(ServerSchema.getErrors(), "");
   } else {
     std::cout << "JSON config is valid!" << std::endl;
   }
@@ -3,25 +3,36 @@
 #include "utils.hpp"
 #include <iostream>
 #include <stdexcept>
+#include <vector>
+
+// The concrete type is fixed at construction, so type queries and accessors
+// below read the tag instead of probing with dynamic_cast.
+AJsonValue::AJsonValue(json_type type) : type_(type), arenaOwned_(false) {}
+
+// Copies (clone(), copy constructors) are always heap allocated, whatever the
+// source was.
+AJsonValue::AJsonValue(const AJsonValue &obj)
+    : type_(obj.type_), arenaOwned_(false) {}
+
+AJsonValue &AJsonValue::operator=(const AJsonValue &) { return *this; }
 
 AJsonValue::~AJsonValue() {}
 
-json_type AJsonValue::getType() const {
-  if (dynamic_cast<const JsonObject *>(this))
-    return OBJECT;
-  else if (dynamic_cast<const JsonArray *>(this))
-    return ARRAY;
-  else if (dynamic_cast<const JsonString *>(this))
-    return STRING;
-  else if (dynamic_cast<const JsonBool *>(this))
-    return BOOLEAN;
-  else if (dynamic_cast<const JsonNumber *>(this))
-    return NUMBER;
-  else if (dynamic_cast<const JsonDouble *>(this))
-    return DOUBLE;
-  return NIL;
+// Nodes placed in a JsonDocument arena only need their destructor to run;
+// their storage is reclaimed with the arena chunks.
+void AJsonValue::release(AJsonValue *value) {
+  if (!value)
+    return;
+  if (value->arenaOwned_)
+    value->~AJsonValue();
+  else
+    delete value;
 }
 
+bool AJsonValue::isArenaOwned() const { return arenaOwned_; }
+
+json_type AJsonValue::getType() const { return type_; }
+
 std::string match_json_name(json_type type) {
   if (type == BOOLEAN)
     return "BOOLEAN";
@@ -39,69 +50,68 @@ std::string match_json_name(json_type type) {
 }
 
 double AJsonValue::asDouble() const {
-  const JsonDouble *json = dynamic_cast<const JsonDouble *>(this);
-  if (!json)
+  if (type_ != DOUBLE)
     return 0.0;
-  return json->value;
+  return static_cast<const JsonDouble *>(this)->value;
 }
 
 long AJsonValue::asNumber() const {
-  const JsonNumber *json = dynamic_cast<const JsonNumber *>(this);
-  if (!json)
+  if (type_ != NUMBER)
     return 0;
-  return json->value;
+  return static_cast<const JsonNumber *>(this)->value;
 }
 
 std::string AJsonValue::asString() const {
-  const JsonString *json = dynamic_cast<const JsonString *>(this);
-  if (!json)
+  if (type_ != STRING)
     return "";
-  return json->value;
+  return static_cast<const JsonString *>(this)->str();
 }
 
 bool AJsonValue::asBool() const {
-  const JsonBool *json = dynamic_cast<const JsonBool *>(this);
-  if (!json)
+  if (type_ != BOOLEAN)
     return false;
-  return json->value;
+  return static_cast<const JsonBool *>(this)->value;
 }
 JsonObject *AJsonValue::asObject() const {
-  const JsonObject *json = dynamic_cast<const JsonObject *>(this);
-  if (!json)
+  if (type_ != OBJECT)
     return NULL;
-  return const_cast<JsonObject *>(json);
+  return const_cast<JsonObject *>(static_cast<const JsonObject *>(this));
 }
 
 JsonObject &AJsonValue::asRefObject() const {
-  const JsonObject *json = dynamic_cast<const JsonObject *>(this);
-  return const_cast<JsonObject &>(*json);
+  return const_cast<JsonObject &>(static_cast<const JsonObject &>(*this));
 }
 
 JsonArray &AJsonValue::asRefArray() const {
-  const JsonArray *json = dynamic_cast<const JsonArray *>(this);
-  return const_cast<JsonArray &>(*json);
+  return const_cast<JsonArray &>(static_cast<const JsonArray &>(*this));
+}
+
+// Access to the text without the copy asString() makes.
+JsonString *AJsonValue::asJsonString() const {
+  if (type_ != STRING)
+    return NULL;
+  return const_cast<JsonString *>(static_cast<const JsonString *>(this));
 }
 
 JsonArray *AJsonValue::asArray() const {
-  const JsonArray *json = dynamic_cast<const JsonArray *>(this);
-  if (!json)
+  if (type_ != ARRAY)
     return NULL;
-  return const_cast<JsonArray *>(json);
+  return const_cast<JsonArray *>(static_cast<const JsonArray *>(this));
 }
 
 AJsonValue &AJsonValue::operator[](const std::string &item) {
   static JsonNull null;
-  JsonObject *obj = dynamic_cast<JsonObject *>(this);
+  JsonObject *obj = asObject();
   if (!obj)
     return null;
   JsonObject::iterator it = obj->members.find(item);
-  if (it == (*obj).members.end())
+  if (it == (*obj).members.end() || !it->second)
     return null;
   return *(it->second);
 }
 
 AJsonValue &AJsonValue::operator[](const unsigned long &idx) {
-  JsonArray *arr = dynamic_cast<JsonArray *>(this);
+  JsonArray *arr = asArray();
   static JsonNull null;
   if (!arr || idx >= arr->size())
     return null;
@@ -109,17 +119,17 @@ AJsonValue &AJsonValue::operator[](const unsigned long &idx) {
 }
 
 AJsonValue &AJsonValue::at(const std::string &item) {
-  JsonObject *obj = dynamic_cast<JsonObject *>(this);
+  JsonObject *obj = asObject();
   if (!obj)
     throw std::runtime_error("Not an object");
   JsonObject::iterator it = obj->members.find(item);
-  if (it == obj->members.end())
+  if (it == obj->members.end() || !it->second)
     throw std::runtime_error("Key '" + item + "' not found");
   return *(it->second);
 }
 
 AJsonValue &AJsonValue::at(const unsigned long &idx) {
-  JsonArray *arr = dynamic_cast<JsonArray *>(this);
+  JsonArray *arr = asArray();
   if (!arr)
     throw std::runtime_error("Not an array");
   if (idx >= arr->size())
@@ -128,126 +138,138 @@ AJsonValue &AJsonValue::at(const unsigned long &idx) {
 }
 
 AJsonValue &AJsonValue::operator[](const std::string &item) const {
-  const JsonObject *obj = dynamic_cast<const JsonObject *>(this);
+  const JsonObject *obj = asObject();
   static JsonNull null;
   if (!obj)
     return null;
   JsonObject::const_iterator it = obj->members.find(item);
-  if (!obj || it == (*obj).members.end())
+  if (it == (*obj).members.end() || !it->second)
     return null;
   return *(it->second);
 }
 
 AJsonValue &AJsonValue::operator[](const unsigned long &idx) const {
-  const JsonArray *arr = dynamic_cast<const JsonArray *>(this);
+  const JsonArray *arr = asArray();
   static JsonNull null;
   if (!arr || idx >= arr->size())
     return null;
-  return (*arr).at(idx);
+  return *arr->elements[idx];
 }
 
 AJsonValue &AJsonValue::at(const std::string &item) const {
-  const JsonObject *obj = dynamic_cast<const JsonObject *>(this);
+  const JsonObject *obj = asObject();
   if (!obj)
     throw std::runtime_error("Not an object");
   JsonObject::const_iterator it = obj->members.find(item);
-  if (it == obj->members.end())
+  if (it == obj->members.end() || !it->second)
     throw std::runtime_error("Key '" + item + "' not found");
   return *(it->second);
 }
 
 AJsonValue &AJsonValue::at(const unsigned long &idx) const {
-  const JsonArray *arr = dynamic_cast<const JsonArray *>(this);
+  const JsonArray *arr = asArray();
   if (!arr)
     throw std::runtime_error("Not an array");
   if (idx >= arr->size())
     throw std::runtime_error("Index [" + to_string(idx) + "] out of range");
-  return (*arr).at(idx);
+  return *arr->elements[idx];
 }
 
-bool AJsonValue::isArray() const {
-  return (dynamic_cast<const JsonArray *>(this));
-}
-bool AJsonValue::isObject() const {
-  return (dynamic_cast<const JsonObject *>(this));
-}
-bool AJsonValue::isNumber() const {
-  return (dynamic_cast<const JsonNumber *>(this));
-}
-bool AJsonValue::isString() const {
-  return (dynamic_cast<const JsonString *>(this));
-}
-bool AJsonValue::isDouble() const {
-  return (dynamic_cast<const JsonDouble *>(this));
-}
-bool AJsonValue::isNull() const {
-  return (dynamic_cast<const JsonNull *>(this));
-}
+bool AJsonValue::isArray() const { return type_ == ARRAY; }
+bool AJsonValue::isObject() const { return type_ == OBJECT; }
+bool AJsonValue::isNumber() const { return type_ == NUMBER; }
+bool AJsonValue::isString() const { return type_ == STRING; }
+bool AJsonValue::isDouble() const { return type_ == DOUBLE; }
+bool AJsonValue::isNull() const { return type_ == NIL; }
 bool AJsonValue::isEmpty() const {
   return dynamic_cast<const void *>(this) == NULL;
 }
-bool AJsonValue::isBool() const {
-  return (dynamic_cast<const JsonBool *>(this));
-}
+bool AJsonValue::isBool() const { return type_ == BOOLEAN; }
 
 AJsonValue::operator bool_type() const {
-  return getType() == NIL ? 0 : &AJsonValue::dummy;
+  return type_ == NIL ? 0 : &AJsonValue::dummy;
 }
 
 void AJsonValue::dummy() const {}
 
 bool AJsonValue::operator==(const AJsonValue &obj) {
-  if (getType() != obj.getType())
+  if (type_ != obj.type_)
     return false;
   return isEqual(obj);
 }
 
 bool AJsonValue::operator==(AJsonValue &obj) {
-  if (getType() != obj.getType())
+  if (type_ != obj.type_)
     return false;
   return isEqual(obj);
 }
 
+static void print_scalar(std::ostream &os, const AJsonValue *v) {
+  if (!v || v->isNull()) {
+    os << "(null)";
+  } else if (v->isString()) {
+    const JsonString *string = v->asJsonString();
+    os << '"';
+    os.write(string->data(), string->size());
+    os << '"';
+  } else if (v->isNumber()) {
+    os << v->asNumber();
+  } else if (v->isDouble()) {
+    os << v->asDouble();
+  } else if (v->isBool()) {
+    os << (v->asBool() ? "true" : "false");
+  }
+}
+
+// A container being printed and the position of its next child.
+struct PrintFrame {
+  const AJsonValue *container;
+  size_t next;
+  unsigned indent;
+};
+
+// Nested containers are kept on an explicit stack rather than recursed into.
 std::ostream &printJson(std::ostream &os, const AJsonValue &v,
                         unsigned indent) {
-  const std::string indentStr(indent * 2, ' ');
+  std::vector<PrintFrame> open;
+  const AJsonValue *value = &v;
 
-  if (v.isNull() || v.isEmpty()) {
-    os << "(null)";
-  } else if (v.isString()) {
-    os << '"' << v.asString() << '"';
-  } else if (v.isNumber()) {
-    os << v.asNumber();
-  } else if (v.isDouble()) {
-    os << v.asDouble();
-  } else if (v.isBool()) {
-    os << (v.asBool() ? "true" : "false");
-  } else if (v.isObject()) {
-    JsonObject &obj = *v.asObject();
-    os << "{\n";
-    JsonObject::const_iterator it = obj.begin();
-    while (it != obj.end()) {
-      os << std::string((indent + 1) * 2, ' ') << '"' << it->first << "\": ";
-      printJson(os, *it->second, indent + 1);
-      ++it;
-      if (it != obj.end())
-        os << ",";
-      os << "\n";
-    }
-    os << indentStr << "}";
-  } else if (v.isArray()) {
-    JsonArray &arr = *v.asArray();
-    os << "[\n";
-    for (size_t i = 0; i < arr.size(); ++i) {
-      os << std::string((indent + 1) * 2, ' ');
-      printJson(os, arr[i], indent + 1);
-      if (i + 1 < arr.size())
-        os << ",";
-      os << "\n";
+  while (true) {
+    if (value && (value->isObject() || value->isArray())) {
+      os << (value->isObject() ? "{\n" : "[\n");
+      PrintFrame frame = {value, 0, indent};
+      open.push_back(frame);
+    } else
+      print_scalar(os, value);
+
+    value = NULL;
+    while (!open.empty()) {
+      PrintFrame &frame = open.back();
+      const JsonObject *obj = frame.container->asObject();
+      size_t count = obj ? obj->size() : frame.container->asArray()->size();
+      if (frame.next) {
+        if (frame.next < count)
+          os << ",";
+        os << "\n";
+      }
+      if (frame.next < count) {
+        os << std::string((frame.indent + 1) * 2, ' ');
+        if (obj) {
+          JsonObject::const_iterator it = obj->begin() + frame.next;
+          os << '"' << it->first << "\": ";
+          value = it->second;
+        } else
+          value = frame.container->asArray()->elements[frame.next];
+        indent = frame.indent + 1;
+        ++frame.next;
+        break;
+      }
+      os << std::string(frame.indent * 2, ' ') << (obj ? "}" : "]");
+      open.pop_back();
     }
-    os << indentStr << "]";
+    if (open.empty())
+      return os;
   }
-  return os;
 }
 
 std::ostream &operator<<(std::ostream &os, const AJsonValue &v) {
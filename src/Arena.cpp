@@ -0,0 +1,100 @@
+#include "Arena.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+Arena::Arena(size_t chunkSize)
+    : head_(NULL), tail_(NULL), free_(NULL), cur_(NULL), end_(NULL),
+      chunkSize_(chunkSize), chunks_(0), mallocs_(0), used_(0) {}
+
+void Arena::releaseChunks(Chunk *chunk) {
+  while (chunk) {
+    Chunk *next = chunk->next;
+    std::free(chunk);
+    chunk = next;
+  }
+}
+
+Arena::~Arena() {
+  releaseChunks(head_);
+  releaseChunks(free_);
+}
+
+// First chunk set aside by rewind() that holds `size` bytes, unlinked.
+Arena::Chunk *Arena::reuse(size_t size) {
+  for (Chunk **link = &free_; *link; link = &(*link)->next) {
+    Chunk *chunk = *link;
+    if (chunk->size >= size) {
+      *link = chunk->next;
+      return chunk;
+    }
+  }
+  return NULL;
+}
+
+// The chunk header is padded to ALIGNMENT so the first allocation of every
+// chunk is aligned like the following ones.
+void *Arena::grow(size_t size) {
+  const size_t header = (sizeof(Chunk) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+  Chunk *chunk = reuse(size);
+  if (!chunk) {
+    size_t capacity = size > chunkSize_ ? size : chunkSize_;
+    chunk = static_cast<Chunk *>(std::malloc(header + capacity));
+    if (!chunk)
+      throw std::bad_alloc();
+    chunk->size = capacity;
+    mallocs_++;
+  }
+  chunk->next = head_;
+  if (!head_)
+    tail_ = chunk;
+  head_ = chunk;
+  chunks_++;
+  cur_ = reinterpret_cast<char *>(chunk) + header;
+  end_ = cur_ + chunk->size;
+  void *ptr = cur_;
+  cur_ += size;
+  used_ += size;
+  return ptr;
+}
+
+char *Arena::copy(const char *data, size_t length) {
+  char *dst = static_cast<char *>(allocate(length + 1));
+  std::memcpy(dst, data, length);
+  dst[length] = '\0';
+  return dst;
+}
+
+// Keeps the most recent chunk so a reused arena does not go back to malloc
+// for documents that fit in it.
+void Arena::reset() {
+  releaseChunks(free_);
+  free_ = NULL;
+  if (!head_)
+    return;
+  releaseChunks(head_->next);
+  head_->next = NULL;
+  tail_ = head_;
+  chunks_ = 1;
+  used_ = 0;
+  const size_t header = (sizeof(Chunk) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+  cur_ = reinterpret_cast<char *>(head_) + header;
+  end_ = cur_ + head_->size;
+}
+
+void Arena::rewind() {
+  if (!head_)
+    return;
+  tail_->next = free_;
+  free_ = head_;
+  head_ = tail_ = NULL;
+  cur_ = end_ = NULL;
+  chunks_ = 0;
+  used_ = 0;
+}
+
+size_t Arena::chunks() const { return chunks_; }
+
+size_t Arena::mallocs() const { return mallocs_; }
+
+size_t Arena::used() const { return used_; }
@@ -0,0 +1,803 @@
+#include "CompiledSchema.hpp"
+#include "JsonTypes.hpp"
+#include "JsonValue.hpp"
+#include "adapters.hpp"
+#include "utils.hpp"
+#include <cstring>
+
+static const unsigned NONE = static_cast<unsigned>(-1);
+static const size_t NO_LIMIT = static_cast<size_t>(-1);
+
+static std::string type_prefix(json_type type) {
+  return "Excepted: " + match_json_name(type) + ", got: ";
+}
+
+CompiledSchema::CompiledSchema() {}
+
+CompiledSchema::CompiledSchema(const AJsonValidator &validator) {
+  compile(validator);
+}
+
+CompiledSchema::~CompiledSchema() { clear(); }
+
+void CompiledSchema::clear() {
+  for (size_t i = 0; i < checks_.size(); ++i)
+    delete checks_[i].checker;
+  for (size_t i = 0; i < calls_.size(); ++i)
+    delete calls_[i];
+  program_.clear();
+  properties_.clear();
+  slots_.clear();
+  conditions_.clear();
+  checks_.clear();
+  messages_.clear();
+  calls_.clear();
+}
+
+// The root is instruction 0.
+void CompiledSchema::compile(const AJsonValidator &validator) {
+  clear();
+  lower(validator);
+}
+
+size_t CompiledSchema::size() const { return program_.size(); }
+
+unsigned CompiledSchema::message(const std::string &text) {
+  messages_.push_back(text);
+  return messages_.size() - 1;
+}
+
+// The messages of an instruction are added before its children are lowered,
+// so they stay contiguous.
+unsigned CompiledSchema::lower(const AJsonValidator &v) {
+  Instruction ins = Instruction();
+  ins.type = v.exceptedType_;
+  ins.flags = (v.get_optional() ? F_OPTIONAL : 0) |
+              (v.has_default() ? F_DEFAULT : 0);
+  ins.child = ins.value = NONE;
+  unsigned pc = program_.size();
+  program_.push_back(ins);
+
+  if (const ObjectValidator *o = dynamic_cast<const ObjectValidator *>(&v)) {
+    ins.message = message(type_prefix(OBJECT));
+    message("Object must not be empty!");
+    message("Missing Field!");
+    message("Unexpected property");
+    if (o->emptyCheck)
+      ins.flags |= F_NOT_EMPTY;
+    if (!o->allowAdditional_)
+      ins.flags |= F_CLOSED;
+    if (o->matchMode_) {
+      ins.op = OP_MATCH;
+      ins.child = lower(*o->key_validator);
+      ins.value = lower(*o->val_validator);
+    } else {
+      ins.op = OP_OBJECT;
+      std::vector<Property> props;
+      ObjectValidator::const_iterator it = o->properties_.begin();
+      for (; it != o->properties_.end(); ++it) {
+        Property p = {it->first, lower(*it->second)};
+        props.push_back(p);
+      }
+      ins.first = properties_.size();
+      ins.count = props.size();
+      properties_.insert(properties_.end(), props.begin(), props.end());
+      table(ins);
+    }
+  } else if (const ArrayValidator *a =
+                 dynamic_cast<const ArrayValidator *>(&v)) {
+    ins.op = OP_ARRAY;
+    ins.message = message(type_prefix(ARRAY));
+    message("Array too small (min " + to_string(a->min_) + ")");
+    message("Array too large (max " + to_string(a->max_) + ")");
+    ins.lower = a->min_;
+    ins.upper = a->max_;
+    if (a->validator_)
+      ins.child = lower(*a->validator_);
+  } else if (const ORValidator *o = dynamic_cast<const ORValidator *>(&v)) {
+    ins.op = OP_OR;
+    ins.message = message("No conditions specified in ANY validator");
+    if (!o->msg_.empty()) {
+      message(o->msg_);
+      ins.flags |= F_MESSAGE;
+    }
+    std::vector<unsigned> branches;
+    for (size_t i = 0; i < o->conditions_.size(); ++i)
+      branches.push_back(lower(*o->conditions_[i]));
+    ins.first = conditions_.size();
+    ins.count = branches.size();
+    conditions_.insert(conditions_.end(), branches.begin(), branches.end());
+  } else if (const StringValidator *s =
+                 dynamic_cast<const StringValidator *>(&v)) {
+    ins.op = OP_STRING;
+    ins.message = message(type_prefix(STRING));
+    message("String must have at least (" + to_string(s->min_) + ") chars!");
+    message("String must have at most (" + to_string(s->max_) + ") chars!");
+    if (s->checkMin)
+      ins.flags |= F_MIN;
+    if (s->checkMax)
+      ins.flags |= F_MAX;
+    ins.lower = s->min_;
+    ins.upper = s->max_;
+    ins.first = checks_.size();
+    std::map<std::string, funcCheck>::const_iterator it = s->checkers.begin();
+    for (; it != s->checkers.end(); ++it) {
+      if (!it->second.func && !it->second.checker)
+        continue;
+      StringCheck check = {it->second.func, NULL, message(it->second.error)};
+      if (it->second.checker)
+        check.checker = it->second.checker->clone();
+      checks_.push_back(check);
+    }
+    ins.count = checks_.size() - ins.first;
+  } else if (const NumberValidator *n =
+                 dynamic_cast<const NumberValidator *>(&v)) {
+    ins.op = OP_NUMBER;
+    ins.message = message(type_prefix(NUMBER));
+    message("Number must be between (" + to_string(n->min_) + ") and (" +
+            to_string(n->max_) + ")!");
+    message("Number must be big than or equal to (" + to_string(n->min_) +
+            ")!");
+    message("Number must be less than or equal to (" + to_string(n->max_) +
+            ")!");
+    if (n->checkMin)
+      ins.flags |= F_MIN;
+    if (n->checkMax)
+      ins.flags |= F_MAX;
+    ins.min = n->min_;
+    ins.max = n->max_;
+  } else if (dynamic_cast<const BoolValidator *>(&v)) {
+    ins.op = OP_BOOL;
+    ins.message = message(type_prefix(BOOLEAN));
+  } else if (dynamic_cast<const TypeValidator *>(&v)) {
+    ins.op = OP_TYPE;
+    ins.message = message(type_prefix(v.exceptedType_));
+  } else {
+    ins.op = OP_CALL;
+    ins.child = calls_.size();
+    calls_.push_back(v.clone());
+  }
+  program_[pc] = ins;
+  return pc;
+}
+
+// Open addressing over the properties of one object, at most half full.
+void CompiledSchema::table(Instruction &ins) {
+  size_t size = 1;
+  while (size < 2 * ins.count)
+    size <<= 1;
+  ins.slots = slots_.size();
+  ins.mask = size - 1;
+  slots_.resize(slots_.size() + size, NONE);
+  for (unsigned i = ins.first; i < ins.first + ins.count; ++i) {
+    size_t j = properties_[i].key.hash() & ins.mask;
+    while (slots_[ins.slots + j] != NONE)
+      j = (j + 1) & ins.mask;
+    slots_[ins.slots + j] = i;
+  }
+}
+
+// Index in properties_ of the property named `key`, or NONE.
+unsigned CompiledSchema::slot(const Instruction &ins, const char *key,
+                              size_t length, size_t hash) const {
+  for (size_t j = hash & ins.mask;; j = (j + 1) & ins.mask) {
+    unsigned i = slots_[ins.slots + j];
+    if (i == NONE)
+      return NONE;
+    const JsonKey &name = properties_[i].key;
+    if (name.hash() == hash && name.size() == length &&
+        std::memcmp(name.data(), key, length) == 0)
+      return i;
+  }
+}
+
+void CompiledSchema::fail(std::vector<ValidationError> &errors,
+                          const SchemaPath &path, unsigned message) const {
+  errors.push_back(ValidationError(path.str(), messages_[message]));
+}
+
+bool CompiledSchema::checkType(const Instruction &ins, json_type expected,
+                               json_type got,
+                               std::vector<ValidationError> &errors,
+                               const SchemaPath &path) const {
+  if (got == expected)
+    return true;
+  errors.push_back(ValidationError(
+      path.str(), messages_[ins.message] + match_json_name(got)));
+  return false;
+}
+
+bool CompiledSchema::checkString(const Instruction &ins, const JsonString &s,
+                                 std::vector<ValidationError> &errors,
+                                 const SchemaPath &path) const {
+  size_t length = s.size();
+  if ((ins.flags & F_MIN) && length < ins.lower) {
+    fail(errors, path, ins.message + 1);
+    return false;
+  }
+  if ((ins.flags & F_MAX) && length > ins.upper) {
+    fail(errors, path, ins.message + 2);
+    return false;
+  }
+  for (unsigned i = ins.first; i < ins.first + ins.count; ++i) {
+    const StringCheck &check = checks_[i];
+    if (check.func ? !check.func(s) : !(*check.checker)(s)) {
+      fail(errors, path, check.message);
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename Node>
+bool CompiledSchema::run(unsigned pc, const Node &v, ErrorSink &errors,
+                         const SchemaPath &path) const {
+  const Instruction &ins = program_[pc];
+  switch (ins.op) {
+  case OP_OBJECT:
+    return object(ins, v, errors, path);
+  case OP_MATCH:
+    return match(ins, v, errors, path);
+  case OP_ARRAY: {
+    if (!checkType(ins, ARRAY, v.getType(), errors.list, path))
+      return false;
+    size_t size = node_size(v);
+    bool valid = true;
+    SchemaPath bounds = path.child(SchemaPath::SIZE, NULL, 0);
+    if (size < ins.lower) {
+      fail(errors.list, bounds, ins.message + 1);
+      valid = false;
+    }
+    if (size > ins.upper && !errors.full()) {
+      fail(errors.list, bounds, ins.message + 2);
+      valid = false;
+    }
+    if (errors.full())
+      return false;
+    if (ins.child != NONE)
+      for (size_t i = 0; i < size; ++i) {
+        SchemaPath item = path.child(SchemaPath::ITEM, NULL, i);
+        if (!run(ins.child, node_at(v, i), errors, item)) {
+          valid = false;
+          if (errors.full())
+            return false;
+        }
+      }
+    return valid;
+  }
+  case OP_OR:
+    return any(ins, v, errors, path);
+  case OP_STRING: {
+    if (!checkType(ins, STRING, v.getType(), errors.list, path))
+      return false;
+    JsonString tmp;
+    return checkString(ins, as_json_string(v, tmp), errors.list, path);
+  }
+  case OP_NUMBER: {
+    if (!checkType(ins, NUMBER, v.getType(), errors.list, path))
+      return false;
+    long value = v.asNumber();
+    bool low = (ins.flags & F_MIN) && value < ins.min;
+    bool high = (ins.flags & F_MAX) && value > ins.max;
+    if ((ins.flags & F_MIN) && (ins.flags & F_MAX) && (low || high))
+      fail(errors.list, path, ins.message + 1);
+    else if (low)
+      fail(errors.list, path, ins.message + 2);
+    else if (high)
+      fail(errors.list, path, ins.message + 3);
+    return !low && !high;
+  }
+  case OP_BOOL:
+    return checkType(ins, BOOLEAN, v.getType(), errors.list, path);
+  case OP_TYPE:
+    return checkType(ins, ins.type, v.getType(), errors.list, path);
+  default:
+    return calls_[ins.child]->validateAt(v, path, errors);
+  }
+}
+
+// One pass over the members fills a slot per property, the last of
+// duplicate keys winning as in JsonValue::find(); the properties are then
+// checked in the order of the tree, and the additional members reported
+// after them.
+template <typename Node>
+bool CompiledSchema::object(const Instruction &ins, const Node &v,
+                            ErrorSink &errors, const SchemaPath &path) const {
+  if (!checkType(ins, OBJECT, v.getType(), errors.list, path))
+    return false;
+  if ((ins.flags & F_NOT_EMPTY) && node_size(v) < 1) {
+    fail(errors.list, path, ins.message + 1);
+    return false;
+  }
+  const Node *local[16];
+  std::vector<const Node *> heap;
+  const Node **found = local;
+  if (ins.count > 16) {
+    heap.resize(ins.count);
+    found = &heap[0];
+  }
+  for (unsigned i = 0; i < ins.count; ++i)
+    found[i] = NULL;
+  bool additional = false;
+  for (MemberCursor<Node> it(v); !it.done(); it.next()) {
+    unsigned i = slot(ins, it.keyData(), it.keyLength(), it.keyHash());
+    if (i == NONE)
+      additional = true;
+    else
+      found[i - ins.first] = &it.value();
+  }
+
+  bool valid = true;
+  for (unsigned i = 0; i < ins.count; ++i) {
+    const Property &p = properties_[ins.first + i];
+    SchemaPath member =
+        path.child(SchemaPath::PROPERTY, p.key.data(), p.key.size());
+    if (!found[i] || found[i]->isNull()) {
+      if (program_[p.node].flags & (F_OPTIONAL | F_DEFAULT))
+        continue;
+      fail(errors.list, member, ins.message + 2);
+      valid = false;
+    } else if (!run(p.node, *found[i], errors, member))
+      valid = false;
+    if (!valid && errors.full())
+      return false;
+  }
+  if (additional && (ins.flags & F_CLOSED))
+    for (MemberCursor<Node> it(v); !it.done(); it.next())
+      if (slot(ins, it.keyData(), it.keyLength(), it.keyHash()) == NONE) {
+        SchemaPath member =
+            path.child(SchemaPath::PROPERTY, it.keyData(), it.keyLength());
+        fail(errors.list, member, ins.message + 3);
+        valid = false;
+        if (errors.full())
+          return false;
+      }
+  return valid;
+}
+
+// Keys are checked as strings viewing the key text.
+template <typename Node>
+bool CompiledSchema::match(const Instruction &ins, const Node &v,
+                           ErrorSink &errors, const SchemaPath &path) const {
+  if (!checkType(ins, OBJECT, v.getType(), errors.list, path))
+    return false;
+  if ((ins.flags & F_NOT_EMPTY) && node_size(v) < 1) {
+    fail(errors.list, path, ins.message + 1);
+    return false;
+  }
+  bool valid = true;
+  for (MemberCursor<Node> it(v); !it.done(); it.next()) {
+    SchemaPath member =
+        path.child(SchemaPath::MATCH, it.keyData(), it.keyLength());
+    const JsonString key(it.keyData(), it.keyLength());
+    if (!run<AJsonValue>(ins.child, key, errors, member))
+      valid = false;
+    if (!valid && errors.full())
+      return false;
+    if (!run(ins.value, it.value(), errors, member))
+      valid = false;
+    if (!valid && errors.full())
+      return false;
+  }
+  return valid;
+}
+
+// The best failed branch keeps its errors at the end of the list, from
+// `mark`; each new branch appends after it and is dropped, or moved down in
+// its place when it is a better candidate. Every branch may add as many
+// errors as the OR itself, or one when the OR has a message of its own.
+template <typename Node>
+bool CompiledSchema::any(const Instruction &ins, const Node &v,
+                         ErrorSink &errors, const SchemaPath &path) const {
+  if (!ins.count) {
+    fail(errors.list, path, ins.message);
+    return false;
+  }
+  size_t mark = errors.list.size();
+  size_t limit = errors.limit;
+  size_t room = (ins.flags & F_MESSAGE) ? 1
+                : limit == NO_LIMIT      ? NO_LIMIT
+                                         : limit - mark;
+  bool anyValid = false;
+  for (unsigned i = ins.first; i < ins.first + ins.count; ++i) {
+    unsigned branch = conditions_[i];
+    size_t start = errors.list.size();
+    ErrorSink own = {errors.list, room == NO_LIMIT ? NO_LIMIT : start + room};
+    if (run(branch, v, own, path)) {
+      errors.list.resize(mark, ValidationError("", ""));
+      return true;
+    }
+    size_t count = errors.list.size() - start;
+    if (count && v.getType() == program_[branch].type) {
+      if (!anyValid || count < start - mark) {
+        errors.list.erase(errors.list.begin() + mark,
+                          errors.list.begin() + start);
+        anyValid = true;
+        continue;
+      }
+    } else if (!anyValid && start == mark)
+      continue;
+    errors.list.resize(start, ValidationError("", ""));
+  }
+  if (ins.flags & F_MESSAGE) {
+    errors.list.resize(mark, ValidationError("", ""));
+    fail(errors.list, path, ins.message + 1);
+  }
+  return false;
+}
+
+template <typename Node>
+bool CompiledSchema::check(const Node &v, std::vector<ValidationError> &errors,
+                           const ValidateOptions &options,
+                           const std::string &path) const {
+  if (program_.empty())
+    return true;
+  SchemaPath root = SchemaPath::start(path);
+  ErrorSink sink = {errors, options.maxErrors
+                                ? errors.size() + options.maxErrors
+                                : NO_LIMIT};
+  return run(0, v, sink, root);
+}
+
+bool CompiledSchema::validate(const AJsonValue *v,
+                              std::vector<ValidationError> &errors,
+                              const std::string &path) const {
+  return check(*v, errors, ValidateOptions(), path);
+}
+
+bool CompiledSchema::validate(const JsonValue *v,
+                              std::vector<ValidationError> &errors,
+                              const std::string &path) const {
+  return check(*v, errors, ValidateOptions(), path);
+}
+
+bool CompiledSchema::validate(const AJsonValue *v,
+                              std::vector<ValidationError> &errors,
+                              const ValidateOptions &options,
+                              const std::string &path) const {
+  return check(*v, errors, options, path);
+}
+
+bool CompiledSchema::validate(const JsonValue *v,
+                              std::vector<ValidationError> &errors,
+                              const ValidateOptions &options,
+                              const std::string &path) const {
+  return check(*v, errors, options, path);
+}
+
+SchemaHandler::SchemaHandler(const CompiledSchema &schema, bool failFast)
+    : schema_(schema), failFast_(failFast), depth_(0),
+      skipping_(0), building_(0), buildPc_(NONE), builder_(INSERTION_ORDER) {}
+
+// Errors of a member replaced by a later duplicate are dropped, so only the
+// errors that remain decide.
+bool SchemaHandler::valid() const { return errors_.empty(); }
+
+const std::vector<ValidationError> &SchemaHandler::getErrors() const {
+  return errors_;
+}
+
+// The frames keep the capacity of their buffers for the next document.
+void SchemaHandler::clear() {
+  depth_ = skipping_ = building_ = 0;
+  builder_.clear();
+  errors_.clear();
+}
+
+SchemaHandler::Frame &SchemaHandler::top() { return frames_[depth_ - 1]; }
+
+// Path of the value about to start.
+SchemaPath SchemaHandler::here() const {
+  if (!depth_)
+    return SchemaPath::start(root_);
+  const Frame &f = frames_[depth_ - 1];
+  switch (schema_.program_[f.pc].op) {
+  case CompiledSchema::OP_ARRAY:
+    return f.path.child(SchemaPath::ITEM, NULL, f.size - 1);
+  case CompiledSchema::OP_MATCH:
+    return f.path.child(SchemaPath::MATCH, f.key.data(), f.key.size());
+  default:
+    return f.path.child(SchemaPath::PROPERTY, f.key.data(), f.key.size());
+  }
+}
+
+// Where the errors of the value about to start go.
+std::vector<ValidationError> &SchemaHandler::destination() {
+  if (!depth_)
+    return errors_;
+  Frame &f = top();
+  const Instruction &ins = schema_.program_[f.pc];
+  if (ins.op == CompiledSchema::OP_OBJECT)
+    return f.found[f.property - ins.first];
+  if (ins.op == CompiledSchema::OP_MATCH)
+    return f.found[f.property];
+  return f.errors;
+}
+
+// Instruction checking the value about to start, NONE for a value nothing
+// checks. An array longer than its bound stops a fail-fast parse here.
+bool SchemaHandler::expect(unsigned &pc) {
+  if (!depth_) {
+    pc = schema_.program_.empty() ? NONE : 0;
+    return true;
+  }
+  Frame &f = top();
+  const Instruction &ins = schema_.program_[f.pc];
+  switch (ins.op) {
+  case CompiledSchema::OP_ARRAY:
+    pc = ins.child;
+    if (++f.size > ins.upper && failFast_) {
+      schema_.fail(f.errors, f.path.child(SchemaPath::SIZE, NULL, 0),
+                   ins.message + 2);
+      return report(false);
+    }
+    return true;
+  case CompiledSchema::OP_MATCH:
+    pc = ins.value;
+    return true;
+  default:
+    pc = f.property == NONE ? NONE : schema_.properties_[f.property].node;
+    return true;
+  }
+}
+
+// False stops the parse.
+bool SchemaHandler::report(bool ok) {
+  if (ok || !failFast_)
+    return true;
+  flush();
+  return false;
+}
+
+// Hands the errors buffered by the open frames over to errors_.
+void SchemaHandler::flush() {
+  for (size_t i = 0; i < depth_; ++i) {
+    Frame &f = frames_[i];
+    for (size_t j = 0; j < f.found.size(); ++j) {
+      errors_.insert(errors_.end(), f.found[j].begin(), f.found[j].end());
+      f.found[j].clear();
+    }
+    errors_.insert(errors_.end(), f.errors.begin(), f.errors.end());
+    f.errors.clear();
+  }
+}
+
+// Runs instruction `pc` on a value as a whole.
+bool SchemaHandler::check(unsigned pc, const AJsonValue &value,
+                          std::vector<ValidationError> &errors,
+                          const SchemaPath &path) {
+  ErrorSink sink = {errors, NO_LIMIT};
+  return schema_.run(pc, value, sink, path);
+}
+
+bool SchemaHandler::scalar(const AJsonValue &value) {
+  if (skipping_)
+    return true;
+  unsigned pc;
+  if (!expect(pc))
+    return false;
+  if (pc == NONE)
+    return true;
+  return report(check(pc, value, destination(), here()));
+}
+
+// Containers get a frame when their instruction reads them member by
+// member. Under an OR or an unknown validator they are built instead, and
+// under any other instruction only their type matters, which an empty
+// container of that type answers.
+bool SchemaHandler::open(json_type type) {
+  if (skipping_) {
+    ++skipping_;
+    return true;
+  }
+  unsigned pc;
+  if (!expect(pc))
+    return false;
+  if (pc == NONE) {
+    skipping_ = 1;
+    return true;
+  }
+  const Instruction &ins = schema_.program_[pc];
+  if (ins.op == CompiledSchema::OP_OR || ins.op == CompiledSchema::OP_CALL) {
+    buildPc_ = pc;
+    buildPath_ = here();
+    building_ = 1;
+    return type == OBJECT ? builder_.onObjectStart() : builder_.onArrayStart();
+  }
+  if (type == OBJECT ? ins.op != CompiledSchema::OP_OBJECT &&
+                           ins.op != CompiledSchema::OP_MATCH
+                     : ins.op != CompiledSchema::OP_ARRAY) {
+    skipping_ = 1;
+    if (type == OBJECT)
+      return report(check(pc, JsonObject(), destination(), here()));
+    return report(check(pc, JsonArray(), destination(), here()));
+  }
+
+  SchemaPath path = here();
+  if (depth_ == frames_.size())
+    frames_.push_back(Frame());
+  Frame &f = frames_[depth_++];
+  f.pc = pc;
+  f.path = path;
+  f.key.clear();
+  f.property = NONE;
+  f.size = 0;
+  f.errors.clear();
+  f.keys.clear();
+  if (ins.op == CompiledSchema::OP_OBJECT) {
+    f.seen.assign(ins.count, 0);
+    f.found.resize(ins.count);
+    for (size_t i = 0; i < f.found.size(); ++i)
+      f.found[i].clear();
+  } else if (ins.op == CompiledSchema::OP_MATCH)
+    f.found.clear();
+  return true;
+}
+
+// A built value is checked once complete, like any other on the tree.
+bool SchemaHandler::built() {
+  if (--building_)
+    return true;
+  AJsonValue *value = builder_.release();
+  bool ok = check(buildPc_, *value, destination(), buildPath_);
+  delete value;
+  return report(ok);
+}
+
+// Emits the errors of the frame in the order of the tree: the properties
+// in order, each with its errors or as missing, then the extra keys; size
+// errors come before those of the elements. A match has its keys in order.
+bool SchemaHandler::close() {
+  if (skipping_) {
+    --skipping_;
+    return true;
+  }
+  Frame &f = top();
+  --depth_;
+  const Instruction &ins = schema_.program_[f.pc];
+  std::vector<ValidationError> &out = destination();
+  bool ok = true;
+  if ((ins.flags & CompiledSchema::F_NOT_EMPTY) && !f.size) {
+    schema_.fail(out, f.path, ins.message + 1);
+    return report(false);
+  }
+  if (ins.op == CompiledSchema::OP_MATCH)
+    for (size_t i = 0; i < f.found.size(); ++i)
+      out.insert(out.end(), f.found[i].begin(), f.found[i].end());
+  else if (ins.op == CompiledSchema::OP_OBJECT)
+    for (unsigned i = 0; i < ins.count; ++i) {
+      if (f.seen[i]) {
+        out.insert(out.end(), f.found[i].begin(), f.found[i].end());
+        continue;
+      }
+      const CompiledSchema::Property &p = schema_.properties_[ins.first + i];
+      if (schema_.program_[p.node].flags &
+          (CompiledSchema::F_OPTIONAL | CompiledSchema::F_DEFAULT))
+        continue;
+      SchemaPath member =
+          f.path.child(SchemaPath::PROPERTY, p.key.data(), p.key.size());
+      schema_.fail(out, member, ins.message + 2);
+      ok = false;
+    }
+  else if (ins.op == CompiledSchema::OP_ARRAY) {
+    SchemaPath bounds = f.path.child(SchemaPath::SIZE, NULL, 0);
+    if (f.size < ins.lower) {
+      schema_.fail(out, bounds, ins.message + 1);
+      ok = false;
+    }
+    if (f.size > ins.upper) {
+      schema_.fail(out, bounds, ins.message + 2);
+      ok = false;
+    }
+  }
+  out.insert(out.end(), f.errors.begin(), f.errors.end());
+  return report(ok);
+}
+
+bool SchemaHandler::onObjectStart() {
+  if (building_) {
+    ++building_;
+    return builder_.onObjectStart();
+  }
+  return open(OBJECT);
+}
+
+// Keys of a match are checked as they come. As on the tree, another value
+// under the same key replaces the first one in its place, and an extra key
+// is reported once however often it repeats.
+bool SchemaHandler::onKey(const std::string &key) {
+  if (building_)
+    return builder_.onKey(key);
+  if (skipping_)
+    return true;
+  Frame &f = top();
+  const Instruction &ins = schema_.program_[f.pc];
+  f.key = key;
+  ++f.size;
+  if (ins.op == CompiledSchema::OP_MATCH) {
+    std::pair<std::map<std::string, unsigned>::iterator, bool> slot =
+        f.keys.insert(std::make_pair(key, f.found.size()));
+    f.property = slot.first->second;
+    if (slot.second)
+      f.found.push_back(std::vector<ValidationError>());
+    else
+      f.found[f.property].clear();
+    const JsonString name(key.data(), key.size());
+    return report(check(ins.child, name, f.found[f.property], here()));
+  }
+  f.property = schema_.slot(ins, key.data(), key.size(),
+                            JsonKey::hash(key.data(), key.size()));
+  if (f.property == NONE) {
+    if (!(ins.flags & CompiledSchema::F_CLOSED) ||
+        !f.keys.insert(std::make_pair(key, NONE)).second)
+      return true;
+    schema_.fail(f.errors, here(), ins.message + 3);
+    return report(false);
+  }
+  f.seen[f.property - ins.first] = 1;
+  f.found[f.property - ins.first].clear();
+  return true;
+}
+
+bool SchemaHandler::onObjectEnd() {
+  if (building_) {
+    builder_.onObjectEnd();
+    return built();
+  }
+  return close();
+}
+
+bool SchemaHandler::onArrayStart() {
+  if (building_) {
+    ++building_;
+    return builder_.onArrayStart();
+  }
+  return open(ARRAY);
+}
+
+bool SchemaHandler::onArrayEnd() {
+  if (building_) {
+    builder_.onArrayEnd();
+    return built();
+  }
+  return close();
+}
+
+bool SchemaHandler::onString(const std::string &value) {
+  if (building_)
+    return builder_.onString(value);
+  return scalar(JsonString(value.data(), value.size()));
+}
+
+bool SchemaHandler::onNumber(long value) {
+  if (building_)
+    return builder_.onNumber(value);
+  return scalar(JsonNumber(value));
+}
+
+bool SchemaHandler::onDouble(double value) {
+  if (building_)
+    return builder_.onDouble(value);
+  return scalar(JsonDouble(value));
+}
+
+bool SchemaHandler::onBool(bool value) {
+  if (building_)
+    return builder_.onBool(value);
+  return scalar(JsonBool(value));
+}
+
+// A null property counts as missing.
+bool SchemaHandler::onNull() {
+  if (building_)
+    return builder_.onNull();
+  if (!skipping_ && depth_) {
+    Frame &f = top();
+    const Instruction &ins = schema_.program_[f.pc];
+    if (ins.op == CompiledSchema::OP_OBJECT && f.property != NONE) {
+      f.seen[f.property - ins.first] = 0;
+      return true;
+    }
+  }
+  return scalar(JsonNull());
+}
@@ -1,103 +1,411 @@
 #include "Json.hpp"
 #include "AJsonValue.hpp"
+#include "JsonDocument.hpp"
+#include "JsonParser.hpp"
 #include "JsonTypes.hpp"
+#include "StructuralIndex.hpp"
 #include "parser.hpp"
-#include <fstream>
-#include <sstream>
+#include "scan.hpp"
+#include "utils.hpp"
+#include <cstring>
+#include <stdexcept>
 #include <vector>
 
-AJsonValue *match_type(token &value) {
-  if (value.type == TK_STRING)
-    return new JsonString(value.token);
+ParseError::ParseError(const std::string &message, const char *begin,
+                       size_t offset)
+    : std::runtime_error(message), offset_(offset), line_(1), column_(1) {
+  const char *p = begin;
+  const char *end = begin + offset;
+  const char *line = begin;
+  while ((p = static_cast<const char *>(std::memchr(p, '\n', end - p)))) {
+    line = ++p;
+    line_++;
+  }
+  column_ += end - line;
+}
+
+size_t ParseError::offset() const { return offset_; }
+size_t ParseError::line() const { return line_; }
+size_t ParseError::column() const { return column_; }
+
+ParseStats::ParseStats() { clear(); }
+
+void ParseStats::clear() {
+  bytes = maxDepth = allocations = 0;
+  for (size_t i = 0; i < UNDEFINED; ++i)
+    nodes[i] = 0;
+  indexSeconds = buildSeconds = 0.0;
+}
+
+size_t ParseStats::totalNodes() const {
+  size_t total = 0;
+  for (size_t i = 0; i < UNDEFINED; ++i)
+    total += nodes[i];
+  return total;
+}
+
+ParseOptions::ParseOptions()
+    : keyOrder(SORTED_KEYS), engine(TOKEN_ENGINE), stringViews(false),
+      maxDepth(DEFAULT_MAX_DEPTH), stats(NULL) {}
+
+// State of one parse. Nodes are heap allocated unless a document is given,
+// in which case they are placed in its arena. The token and the stack of
+// open containers are borrowed from `buffers`.
+struct ParseContext {
+  Tokenizer tz;
+  token &tk;
+  std::vector<AJsonValue *> &open;
+  JsonDocument *doc;
+  const ParseOptions &options;
+
+  ParseContext(const char *begin, const char *end, ParseBuffers &buffers,
+               JsonDocument *doc, const ParseOptions &options)
+      : tz(begin, end, options.stringViews), tk(buffers.tk),
+        open(buffers.open), doc(doc), options(options) {}
+
+  void advance() { tz.next(tk); }
+};
+
+template <typename T> static T *make_node(JsonDocument *doc) {
+  return doc ? doc->create<T>() : new T();
+}
+
+template <typename T, typename A>
+static T *make_node(JsonDocument *doc, const A &arg) {
+  return doc ? doc->create<T>(arg) : new T(arg);
+}
+
+template <typename T, typename A, typename B>
+static T *make_node(JsonDocument *doc, const A &a, const B &b) {
+  return doc ? doc->create<T>(a, b) : new T(a, b);
+}
+
+AJsonValue *match_type(token &value, JsonDocument *doc) {
+  if (value.type == TK_STRING && value.view)
+    return make_node<JsonString>(doc, value.view, value.viewLength);
+  else if (value.type == TK_STRING)
+    return make_node<JsonString>(doc, value.token);
   else if (value.type == TK_NUMBER)
-    return new JsonNumber(value.token);
+    return make_node<JsonNumber>(doc, value.number);
   else if (value.type == TK_DOUBLE)
-    return new JsonDouble(value.token);
+    return make_node<JsonDouble>(doc, value.real);
   else if (value.type == TK_BOOLEAN)
-    return new JsonBool(value.token);
-  return new JsonNull();
-}
-AJsonValue *parse_helper(std::vector<token> &tokens, unsigned long &pos);
-void consume_key(std::vector<token> &tokens, unsigned long &pos,
-                 JsonObject &object) {
-  token key = tokens[pos];
-  pos += 2;
-  token value = tokens[pos];
-  if (object.members.find(key.token) != object.members.end())
-    delete object.members[key.token];
-  if (value.type == CB_OPEN || value.type == SB_OPEN) {
-    object.members[key.token] = parse_helper(tokens, pos);
-  } else {
-    object.members[key.token] = match_type(value);
-    pos++;
+    return make_node<JsonBool>(doc, value.token);
+  return make_node<JsonNull>(doc);
+}
+
+static void malformed() { throw std::runtime_error("Malformed JSON file!"); }
+
+static bool is_scalar(token_type type) {
+  return type == TK_STRING || type == TK_NUMBER || type == TK_DOUBLE ||
+         type == TK_NIL || type == TK_BOOLEAN;
+}
+
+static JsonKey make_key(JsonDocument *doc, const token &tk) {
+  const char *data = tk.view ? tk.view : tk.token.data();
+  size_t length = tk.view ? tk.viewLength : tk.token.size();
+  if (doc)
+    return doc->keys().intern(data, length);
+  return JsonKey(data, length);
+}
+
+static void too_deep() {
+  throw std::runtime_error("Maximum nesting depth exceeded!");
+}
+
+// Reads `"key" :` and leaves `ctx.tk` on the first token of the value.
+template <typename Context> static void read_key(Context &ctx, JsonKey &key) {
+  if (ctx.tk.type != TK_STRING)
+    malformed();
+  key = make_key(ctx.doc, ctx.tk);
+  ctx.advance();
+  if (ctx.tk.type != COLON)
+    malformed();
+  ctx.advance();
+}
+
+// Builds the value starting at `ctx.tk` and returns with `ctx.tk` holding the
+// token that follows it, so the grammar is checked and the tree is built in
+// a single pass over the input. Open containers are kept on an explicit
+// stack bounded by options.maxDepth, not on the call stack. Each one is
+// attached to its parent as soon as it opens, so on error releasing the
+// root frees everything built so far. Both engines share this builder:
+// they only differ in how Context::advance() produces the tokens.
+template <typename Context> static AJsonValue *build_value(Context &ctx) {
+  token &tk = ctx.tk;
+  ParseStats *stats = ctx.options.stats;
+  std::vector<AJsonValue *> &open = ctx.open;
+  AJsonValue *root = NULL;
+  open.clear();
+  JsonKey key;
+  try {
+    for (;;) {
+      AJsonValue *value = NULL;
+      bool container = tk.type == CB_OPEN || tk.type == SB_OPEN;
+      if (container && open.size() >= ctx.options.maxDepth)
+        too_deep();
+      if (tk.type == CB_OPEN)
+        value = make_node<JsonObject>(ctx.doc, ctx.options.keyOrder);
+      else if (tk.type == SB_OPEN)
+        value = make_node<JsonArray>(ctx.doc);
+      else if (is_scalar(tk.type))
+        value = match_type(tk, ctx.doc);
+      else
+        malformed();
+      if (stats) {
+        ++stats->nodes[value->getType()];
+        if (container && open.size() >= stats->maxDepth)
+          stats->maxDepth = open.size() + 1;
+      }
+      if (open.empty())
+        root = value;
+      else if (open.back()->isArray())
+        open.back()->asArray()->elements.push_back(value);
+      else
+        open.back()->asObject()->appendProperty(key, value);
+      ctx.advance();
+
+      if (container) {
+        bool object = value->isObject();
+        if (tk.type != (object ? CB_CLOSE : SB_CLOSE)) {
+          open.push_back(value);
+          if (object)
+            read_key(ctx, key);
+          continue;
+        }
+        ctx.advance();
+      }
+      // The value is complete: move on to the next member or element, or
+      // close the containers it ends.
+      for (;;) {
+        if (open.empty())
+          return root;
+        bool object = open.back()->isObject();
+        if (tk.type == COMMA) {
+          ctx.advance();
+          if (object)
+            read_key(ctx, key);
+          else if (tk.type == SB_CLOSE)
+            malformed();
+          break;
+        }
+        if (tk.type != (object ? CB_CLOSE : SB_CLOSE))
+          malformed();
+        if (object)
+          open.back()->asObject()->finishProperties();
+        open.pop_back();
+        ctx.advance();
+      }
+    }
+  } catch (...) {
+    AJsonValue::release(root);
+    throw;
   }
 }
 
-AJsonValue *parse_object(std::vector<token> &tokens, unsigned long &pos) {
-  JsonObject *object = new JsonObject();
-  pos++;
-  while (pos < tokens.size() && tokens[pos].type != CB_CLOSE) {
-    consume_key(tokens, pos, *object);
-    if (tokens[pos].type == COMMA)
-      pos++;
+// The root must be an object or an array; nothing but whitespace may follow.
+template <typename Context> static AJsonValue *build_document(Context &ctx) {
+  ctx.advance();
+  if (ctx.tk.type == END)
+    return NULL;
+  if (ctx.tk.type != CB_OPEN && ctx.tk.type != SB_OPEN)
+    malformed();
+  AJsonValue *json = build_value(ctx);
+  if (ctx.tk.type != END) {
+    AJsonValue::release(json);
+    malformed();
   }
-  pos++;
-  return object;
+  return json;
 }
 
-static bool is_array_element(token_type type) {
-  return type == TK_STRING || type == TK_NUMBER || type == TK_DOUBLE ||
-         type == TK_NIL || type == TK_BOOLEAN;
+// Gives the message of a failed build the position of the token at which it
+// stopped. Successful parses pay nothing for it.
+template <typename Context>
+static AJsonValue *locate(Context &ctx, AJsonValue *(*build)(Context &),
+                          const char *begin) {
+  try {
+    return build(ctx);
+  } catch (const std::runtime_error &e) {
+    throw ParseError(e.what(), begin, ctx.tk.offset);
+  }
+}
+
+static AJsonValue *parse_document(const char *begin, const char *end,
+                                  ParseBuffers &buffers, JsonDocument *doc,
+                                  const ParseOptions &options) {
+  ParseContext ctx(begin, end, buffers, doc, options);
+  return locate(ctx, build_document<ParseContext>, begin);
 }
 
-AJsonValue *parse_array(std::vector<token> &tokens, unsigned long &pos) {
-  JsonArray *array = new JsonArray();
-  pos++;
-  while (pos < tokens.size() && tokens[pos].type != SB_CLOSE) {
-    if (tokens[pos].type == CB_OPEN)
-      array->elements.push_back(parse_object(tokens, pos));
-    else if (tokens[pos].type == SB_OPEN)
-      array->elements.push_back(parse_array(tokens, pos));
-    else if (is_array_element(tokens[pos].type)) {
-      array->elements.push_back(match_type(tokens[pos]));
-      pos++;
+// Second stage of STRUCTURAL_ENGINE. Tokens come from walking the
+// StructuralIndex: punctuation is read straight from the input, and the
+// tokenizer is only pointed at the start of strings, numbers and literals.
+// A NUL byte where a value or punctuation is expected ends the input, as it
+// does for the tokenizer.
+struct IndexContext {
+  const char *begin;
+  size_t length;
+  const StructuralIndex &index;
+  size_t entry;
+  size_t next;
+  Tokenizer tz;
+  token &tk;
+  std::vector<AJsonValue *> &open;
+  JsonDocument *doc;
+  const ParseOptions &options;
+  size_t junk; // offset of bytes stuck to the last atom, or NO_JUNK
+
+  static const size_t NO_JUNK = static_cast<size_t>(-1);
+
+  IndexContext(const char *begin, const char *end,
+               const StructuralIndex &index, size_t entry,
+               ParseBuffers &buffers, JsonDocument *doc,
+               const ParseOptions &options)
+      : begin(begin), length(end - begin), index(index), entry(entry),
+        next(entry), tz(begin, end, options.stringViews), tk(buffers.tk),
+        open(buffers.open), doc(doc), options(options), junk(NO_JUNK) {}
+
+  size_t position() const { return next < index.size() ? index[next] : length; }
+  char current() const { return next < index.size() ? begin[index[next]] : 0; }
+
+  // Tokenizes the atom at the current position. Only whitespace may separate
+  // it from the next indexed position. Anything else is the token the token
+  // engine would read next and reject, as no value can be followed by one:
+  // it is reported at the next advance(), unless the grammar rejects the
+  // atom itself first, so both engines fail at the same offset.
+  void atom() {
+    tz.seek(position());
+    tz.next(tk);
+    ++next;
+    const char *stop = begin + position();
+    const char *p = begin + tz.offset();
+    if (p != stop && (p = skip_whitespace(p, stop)) != stop)
+      junk = p - begin;
+  }
+
+  void advance() {
+    if (junk != NO_JUNK) {
+      tk.offset = junk;
+      malformed();
     }
-    if (tokens[pos].type == COMMA)
-      pos++;
+    entry = next;
+    tk.offset = position();
+    switch (current()) {
+    case '{':
+      tk.type = CB_OPEN;
+      break;
+    case '}':
+      tk.type = CB_CLOSE;
+      break;
+    case '[':
+      tk.type = SB_OPEN;
+      break;
+    case ']':
+      tk.type = SB_CLOSE;
+      break;
+    case ':':
+      tk.type = COLON;
+      break;
+    case ',':
+      tk.type = COMMA;
+      break;
+    case 0:
+      tk.type = END;
+      return;
+    default:
+      atom();
+      return;
+    }
+    ++next;
   }
-  if (tokens[pos].type == SB_CLOSE)
-    pos++;
-  return array;
+};
+
+static AJsonValue *index_document(const char *begin, const char *end,
+                                  ParseBuffers &buffers, JsonDocument *doc,
+                                  const ParseOptions &options) {
+  double start = options.stats ? monotonic_seconds() : 0.0;
+  buffers.index.build(begin, end);
+  if (options.stats)
+    options.stats->indexSeconds = monotonic_seconds() - start;
+  IndexContext ctx(begin, end, buffers.index, 0, buffers, doc, options);
+  return locate(ctx, build_document<IndexContext>, begin);
 }
 
-AJsonValue *parse_helper(std::vector<token> &tokens, unsigned long &pos) {
-  AJsonValue *json = NULL;
+AJsonValue *Json::parse_indexed(const char *begin, const char *end,
+                               const StructuralIndex &index, size_t entry,
+                               const ParseOptions &options,
+                               JsonDocument *doc, size_t *following) {
+  ParseBuffers buffers;
+  IndexContext ctx(begin, end, index, entry, buffers, doc, options);
+  ctx.advance();
+  AJsonValue *value = locate(ctx, build_value<IndexContext>, begin);
+  if (following)
+    *following = ctx.entry;
+  return value;
+}
+
+static AJsonValue *run_engine(const char *begin, const char *end,
+                              ParseBuffers &buffers, JsonDocument *doc,
+                              const ParseOptions &options) {
+  if (options.engine == STRUCTURAL_ENGINE &&
+      static_cast<size_t>(end - begin) <= StructuralIndex::MAX_LENGTH)
+    return index_document(begin, end, buffers, doc, options);
+  return parse_document(begin, end, buffers, doc, options);
+}
+
+static AJsonValue *parse_with(const char *begin, const char *end,
+                              ParseBuffers &buffers, JsonDocument *doc,
+                              const ParseOptions &options) {
+  ParseStats *stats = options.stats;
+  if (!stats)
+    return run_engine(begin, end, buffers, doc, options);
 
-  if (tokens[pos].type == CB_OPEN)
-    json = parse_object(tokens, pos);
-  else if (tokens[pos].type == SB_OPEN)
-    json = parse_array(tokens, pos);
+  stats->clear();
+  stats->bytes = end - begin;
+  size_t mallocs = doc ? doc->arena().mallocs() : 0;
+  double start = monotonic_seconds();
+  AJsonValue *json = run_engine(begin, end, buffers, doc, options);
+  stats->buildSeconds = monotonic_seconds() - start - stats->indexSeconds;
+  stats->allocations =
+      doc ? doc->arena().mallocs() - mallocs : stats->totalNodes();
   return json;
 }
 
-AJsonValue *Json::parse(std::string filename) {
-  std::ifstream in(filename.c_str());
-  if (!in.is_open()) {
-    throw std::runtime_error("Could not open file: " + filename);
-  }
-  std::vector<token> tokens;
-  Tokenizer::parse(in, tokens);
-  in.close();
-  Lexer::parse(tokens);
-  unsigned long pos = 0;
-  return parse_helper(tokens, pos);
+AJsonValue *Json::parse(std::string filename) { return parseFile(filename); }
+
+AJsonValue *Json::parseFile(const std::string &filename) {
+  return parseFile(filename, ParseOptions());
+}
+
+AJsonValue *Json::parseFile(const std::string &filename,
+                            const ParseOptions &options) {
+  MappedFile file(filename);
+  ParseOptions copying = options;
+  copying.stringViews = false;
+  return parse_raw(file.data(), file.size(), copying);
 }
 
 AJsonValue *Json::parse_raw(std::string raw) {
-  std::istringstream is(raw.c_str());
-  std::vector<token> tokens;
-  Tokenizer::parse(is, tokens);
-  Lexer::parse(tokens);
-  unsigned long pos = 0;
-  return parse_helper(tokens, pos);
+  return parse_raw(raw.data(), raw.size());
+}
+
+AJsonValue *Json::parse_raw(const char *data, size_t length) {
+  return parse_raw(data, length, ParseOptions());
+}
+
+AJsonValue *Json::parse_raw(const char *data, size_t length,
+                            JsonDocument *doc) {
+  return parse_raw(data, length, ParseOptions(), doc);
+}
+
+AJsonValue *Json::parse_raw(const char *data, size_t length,
+                            const ParseOptions &options, JsonDocument *doc) {
+  ParseBuffers buffers;
+  return parse_with(data, data + length, buffers, doc, options);
+}
+
+AJsonValue *Json::parse_raw(const char *data, size_t length,
+                            const ParseOptions &options, JsonDocument *doc,
+                            ParseBuffers &buffers) {
+  return parse_with(data, data + length, buffers, doc, options);
 }
@@ -0,0 +1,293 @@
+#include "JsonDocument.hpp"
+#include "Json.hpp"
+#include "JsonTypes.hpp"
+#include "StructuralIndex.hpp"
+#include "scan.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <exception>
+#include <pthread.h>
+#include <unistd.h>
+
+JsonDocument::JsonDocument(size_t chunkSize)
+    : arena_(chunkSize), root_(NULL), value_(JsonValue::null()),
+      file_(NULL) {}
+
+JsonDocument::~JsonDocument() { clear(); }
+
+AJsonValue *JsonDocument::parse(const std::string &raw,
+                                 const ParseOptions &options) {
+  return parse(raw.data(), raw.size(), options);
+}
+
+AJsonValue *JsonDocument::parse(const char *data, size_t length,
+                                 const ParseOptions &options) {
+  clear();
+  root_ = Json::parse_raw(data, length, options, this);
+  return root_;
+}
+
+AJsonValue *JsonDocument::parseFile(const std::string &filename,
+                                     const ParseOptions &options) {
+  if (!options.stringViews) {
+    MappedFile file(filename);
+    return parse(file.data(), file.size(), options);
+  }
+  MappedFile *file = new MappedFile(filename);
+  try {
+    parse(file->data(), file->size(), options);
+  } catch (...) {
+    delete file;
+    throw;
+  }
+  file_ = file;
+  return root_;
+}
+
+// Pre-scan of a top-level array: the entries its elements start at, and the
+// entry of its closing bracket. Only the nesting is followed here; the
+// elements themselves are checked when they are built.
+static bool split_elements(const char *begin, const StructuralIndex &index,
+                           std::vector<size_t> &starts, size_t &close) {
+  size_t depth = 0;
+  if (index.size() > 1 && begin[index[1]] != ']')
+    starts.push_back(1);
+  for (size_t i = 0; i < index.size(); ++i) {
+    char c = begin[index[i]];
+    if (c == '{' || c == '[')
+      ++depth;
+    else if (c == '}' || c == ']') {
+      if (--depth)
+        continue;
+      close = i;
+      return c == ']' && (i + 1 == index.size() || !begin[index[i + 1]]);
+    } else if (c == ',' && depth == 1)
+      starts.push_back(i + 1);
+    else if (!c)
+      return false;
+  }
+  return false;
+}
+
+// Shared by the workers of one parseParallel() call. Elements are handed out
+// in batches under `lock`, and so are the per-thread documents; each element
+// slot is written by exactly one worker. No batch is handed out once an
+// element has failed.
+struct ElementJob {
+  const char *begin;
+  const char *end;
+  const StructuralIndex &index;
+  const std::vector<size_t> &starts;
+  size_t close;
+  std::vector<AJsonValue *> &elements;
+  std::vector<JsonDocument *> &parts;
+  std::vector<ParseStats> &stats;
+  const ParseOptions &options;
+  pthread_mutex_t lock;
+  size_t next;
+  size_t workers;
+  bool failed;
+
+  static const size_t BATCH = 16;
+
+  ElementJob(const char *begin, const char *end, const StructuralIndex &index,
+             const std::vector<size_t> &starts, size_t close,
+             std::vector<AJsonValue *> &elements,
+             std::vector<JsonDocument *> &parts,
+             std::vector<ParseStats> &stats, const ParseOptions &options)
+      : begin(begin), end(end), index(index), starts(starts), close(close),
+        elements(elements), parts(parts), stats(stats), options(options),
+        next(0), workers(0), failed(false) {
+    pthread_mutex_init(&lock, NULL);
+  }
+  ~ElementJob() { pthread_mutex_destroy(&lock); }
+
+  size_t take() {
+    pthread_mutex_lock(&lock);
+    size_t first = failed ? starts.size() : next;
+    next += BATCH;
+    pthread_mutex_unlock(&lock);
+    return first;
+  }
+
+  size_t join() {
+    pthread_mutex_lock(&lock);
+    size_t worker = workers++;
+    pthread_mutex_unlock(&lock);
+    return worker;
+  }
+
+  void fail() {
+    pthread_mutex_lock(&lock);
+    failed = true;
+    pthread_mutex_unlock(&lock);
+  }
+
+  // Entry that must follow element `i`: its comma, or the closing bracket.
+  size_t stop(size_t i) const {
+    return i + 1 < starts.size() ? starts[i + 1] - 1 : close;
+  }
+};
+
+static void *parse_elements(void *arg) {
+  ElementJob &job = *static_cast<ElementJob *>(arg);
+  size_t worker = job.join();
+  JsonDocument &doc = *job.parts[worker];
+  ParseOptions options = job.options;
+  if (options.stats)
+    options.stats = &job.stats[worker];
+
+  for (size_t first = job.take(); first < job.starts.size();
+       first = job.take()) {
+    size_t last = std::min(first + ElementJob::BATCH, job.starts.size());
+    for (size_t i = first; i < last; ++i) {
+      try {
+        size_t following;
+        job.elements[i] =
+            Json::parse_indexed(job.begin, job.end, job.index, job.starts[i],
+                                options, &doc, &following);
+        if (following == job.stop(i))
+          continue;
+      } catch (const std::exception &) {
+      }
+      job.fail();
+      break;
+    }
+  }
+  return NULL;
+}
+
+AJsonValue *JsonDocument::parseParallel(const char *data, size_t length,
+                                         const ParseOptions &options,
+                                         size_t threads) {
+  const char *end = data + length;
+  const char *first = skip_whitespace(data, end);
+  if (first == end || *first != '[' || length > StructuralIndex::MAX_LENGTH)
+    return parse(data, length, options);
+  clear();
+  size_t mallocs = arena_.mallocs();
+  double start = monotonic_seconds();
+  StructuralIndex index;
+  std::vector<size_t> starts;
+  size_t close = 0;
+  index.build(data, end);
+  if (!options.maxDepth || !split_elements(data, index, starts, close))
+    return parse(data, length, options);
+  double indexed = monotonic_seconds();
+
+  if (!threads) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? cpus : 1;
+  }
+  threads = std::max<size_t>(
+      1, std::min(threads, (starts.size() + ElementJob::BATCH - 1) /
+                               ElementJob::BATCH));
+  for (size_t i = 0; i < threads; ++i)
+    parts_.push_back(new JsonDocument());
+
+  // Elements are children of the root from the start, so clear() releases
+  // those already built if one of them fails.
+  JsonArray *array = create<JsonArray>();
+  root_ = array;
+  array->elements.resize(starts.size(), NULL);
+  ParseOptions elementOptions = options;
+  elementOptions.maxDepth--;
+  std::vector<ParseStats> stats(threads);
+  ElementJob job(data, end, index, starts, close, array->elements, parts_,
+                 stats, elementOptions);
+
+  std::vector<pthread_t> workers;
+  for (size_t i = 1; i < threads; ++i) {
+    pthread_t worker;
+    if (pthread_create(&worker, NULL, parse_elements, &job) != 0)
+      break;
+    workers.push_back(worker);
+  }
+  // The calling thread works too, and finishes alone if no thread started.
+  parse_elements(&job);
+  for (size_t i = 0; i < workers.size(); ++i)
+    pthread_join(workers[i], NULL);
+
+  if (job.failed)
+    return parse(data, length, options);
+  if (options.stats) {
+    ParseStats &total = *options.stats;
+    total.clear();
+    total.bytes = length;
+    total.nodes[ARRAY] = 1;
+    total.maxDepth = 1;
+    total.allocations = arena_.mallocs() - mallocs;
+    for (size_t i = 0; i < threads; ++i) {
+      for (size_t type = 0; type < UNDEFINED; ++type)
+        total.nodes[type] += stats[i].nodes[type];
+      total.maxDepth = std::max(total.maxDepth, stats[i].maxDepth + 1);
+      total.allocations += parts_[i]->arena().mallocs();
+    }
+    total.indexSeconds = indexed - start;
+    total.buildSeconds = monotonic_seconds() - indexed;
+  }
+  return root_;
+}
+
+AJsonValue *JsonDocument::parseParallelFile(const std::string &filename,
+                                             const ParseOptions &options,
+                                             size_t threads) {
+  if (!options.stringViews) {
+    MappedFile file(filename);
+    return parseParallel(file.data(), file.size(), options, threads);
+  }
+  MappedFile *file = new MappedFile(filename);
+  try {
+    parseParallel(file->data(), file->size(), options, threads);
+  } catch (...) {
+    delete file;
+    throw;
+  }
+  file_ = file;
+  return root_;
+}
+
+AJsonValue *JsonDocument::root() const { return root_; }
+
+const JsonValue &JsonDocument::parseCompact(const std::string &raw,
+                                            size_t maxDepth) {
+  return parseCompact(raw.data(), raw.size(), maxDepth);
+}
+
+const JsonValue &JsonDocument::parseCompact(const char *data, size_t length,
+                                            size_t maxDepth) {
+  clear();
+  value_ = Json::parse_compact(data, length, arena_, &keys_, maxDepth);
+  return value_;
+}
+
+const JsonValue &JsonDocument::parseCompactFile(const std::string &filename,
+                                                size_t maxDepth) {
+  MappedFile file(filename);
+  return parseCompact(file.data(), file.size(), maxDepth);
+}
+
+const JsonValue &JsonDocument::value() const { return value_; }
+
+Arena &JsonDocument::arena() { return arena_; }
+
+KeyPool &JsonDocument::keys() { return keys_; }
+
+// The root goes first: its elements may live in the per-thread documents.
+// With keepMemory the arena chunks and the key table are kept for the next
+// parse instead of being freed.
+void JsonDocument::clear(bool keepMemory) {
+  AJsonValue::release(root_);
+  root_ = NULL;
+  for (size_t i = 0; i < parts_.size(); ++i)
+    delete parts_[i];
+  parts_.clear();
+  value_ = JsonValue::null();
+  keys_.clear(keepMemory);
+  if (keepMemory)
+    arena_.rewind();
+  else
+    arena_.reset();
+  delete file_;
+  file_ = NULL;
+}
@@ -0,0 +1,99 @@
+#include "JsonHandler.hpp"
+#include "Json.hpp"
+#include "JsonPushParser.hpp"
+#include "JsonTypes.hpp"
+#include "utils.hpp"
+
+JsonHandler::~JsonHandler() {}
+bool JsonHandler::onObjectStart() { return true; }
+bool JsonHandler::onKey(const std::string &) { return true; }
+bool JsonHandler::onObjectEnd() { return true; }
+bool JsonHandler::onArrayStart() { return true; }
+bool JsonHandler::onArrayEnd() { return true; }
+bool JsonHandler::onString(const std::string &) { return true; }
+bool JsonHandler::onNumber(long) { return true; }
+bool JsonHandler::onDouble(double) { return true; }
+bool JsonHandler::onBool(bool) { return true; }
+bool JsonHandler::onNull() { return true; }
+
+JsonTreeBuilder::JsonTreeBuilder(key_order order)
+    : root_(NULL), order_(order) {}
+
+JsonTreeBuilder::~JsonTreeBuilder() { delete root_; }
+
+AJsonValue *JsonTreeBuilder::root() const { return root_; }
+
+AJsonValue *JsonTreeBuilder::release() {
+  AJsonValue *root = root_;
+  root_ = NULL;
+  open_.clear();
+  return root;
+}
+
+void JsonTreeBuilder::clear() { delete release(); }
+
+bool JsonTreeBuilder::onValue(AJsonValue *, size_t) { return true; }
+
+// Attaches `value` to the innermost open container, or makes it the root.
+bool JsonTreeBuilder::add(AJsonValue *value) {
+  if (open_.empty()) {
+    delete root_;
+    root_ = value;
+  } else if (open_.back()->isArray())
+    open_.back()->asArray()->elements.push_back(value);
+  else
+    open_.back()->asObject()->appendProperty(JsonKey(key_), value);
+  if (value->isObject() || value->isArray()) {
+    open_.push_back(value);
+    return true;
+  }
+  return onValue(value, open_.size());
+}
+
+bool JsonTreeBuilder::end() {
+  AJsonValue *value = open_.back();
+  if (value->isObject())
+    value->asObject()->finishProperties();
+  open_.pop_back();
+  return onValue(value, open_.size());
+}
+
+bool JsonTreeBuilder::onObjectStart() { return add(new JsonObject(order_)); }
+
+bool JsonTreeBuilder::onKey(const std::string &key) {
+  key_ = key;
+  return true;
+}
+
+bool JsonTreeBuilder::onObjectEnd() { return end(); }
+bool JsonTreeBuilder::onArrayStart() { return add(new JsonArray()); }
+bool JsonTreeBuilder::onArrayEnd() { return end(); }
+
+bool JsonTreeBuilder::onString(const std::string &value) {
+  return add(new JsonString(value));
+}
+
+bool JsonTreeBuilder::onNumber(long value) {
+  return add(new JsonNumber(value));
+}
+
+bool JsonTreeBuilder::onDouble(double value) {
+  return add(new JsonDouble(value));
+}
+
+bool JsonTreeBuilder::onBool(bool value) { return add(new JsonBool(value)); }
+bool JsonTreeBuilder::onNull() { return add(new JsonNull()); }
+
+bool Json::sax(const char *data, size_t length, JsonHandler &handler) {
+  JsonPushParser parser(handler);
+  return parser.feed(data, length) && parser.finish();
+}
+
+bool Json::sax(const std::string &raw, JsonHandler &handler) {
+  return sax(raw.data(), raw.size(), handler);
+}
+
+bool Json::saxFile(const std::string &filename, JsonHandler &handler) {
+  MappedFile file(filename);
+  return sax(file.data(), file.size(), handler);
+}
@@ -0,0 +1,131 @@
+#include "JsonKey.hpp"
+#include <algorithm>
+#include <cstring>
+
+// FNV-1a (32-bit parameters)
+size_t JsonKey::hash(const char *data, size_t length) {
+  size_t h = 2166136261u;
+  for (size_t i = 0; i < length; ++i) {
+    h ^= static_cast<unsigned char>(data[i]);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+JsonKey::JsonKey() : entry_(NULL), hash_(hash("", 0)) {}
+
+JsonKey::JsonKey(const std::string &text)
+    : text_(text), entry_(NULL), hash_(hash(text.data(), text.size())) {}
+
+JsonKey::JsonKey(const char *data, size_t length)
+    : text_(data, length), entry_(NULL), hash_(hash(data, length)) {}
+
+JsonKey::JsonKey(const Entry *entry) : entry_(entry), hash_(entry->hash) {}
+
+JsonKey::JsonKey(const JsonKey &obj)
+    : text_(obj.text_), entry_(obj.entry_), hash_(obj.hash_) {}
+
+JsonKey &JsonKey::operator=(const JsonKey &obj) {
+  text_ = obj.text_;
+  entry_ = obj.entry_;
+  hash_ = obj.hash_;
+  return *this;
+}
+
+void JsonKey::swap(JsonKey &obj) {
+  text_.swap(obj.text_);
+  std::swap(entry_, obj.entry_);
+  std::swap(hash_, obj.hash_);
+}
+
+const std::string &JsonKey::str() const {
+  return entry_ ? entry_->text : text_;
+}
+
+JsonKey::operator const std::string &() const { return str(); }
+
+const char *JsonKey::data() const { return str().data(); }
+
+size_t JsonKey::size() const { return str().size(); }
+
+size_t JsonKey::hash() const { return hash_; }
+
+bool JsonKey::isInterned() const { return entry_ != NULL; }
+
+bool JsonKey::operator==(const JsonKey &obj) const {
+  if (entry_ && entry_ == obj.entry_)
+    return true;
+  return hash_ == obj.hash_ && str() == obj.str();
+}
+
+bool JsonKey::operator!=(const JsonKey &obj) const { return !(*this == obj); }
+
+bool JsonKey::operator<(const JsonKey &obj) const { return str() < obj.str(); }
+
+bool operator==(const JsonKey &key, const std::string &str) {
+  return key.str() == str;
+}
+
+bool operator!=(const JsonKey &key, const std::string &str) {
+  return key.str() != str;
+}
+
+std::ostream &operator<<(std::ostream &os, const JsonKey &key) {
+  return os << key.str();
+}
+
+KeyPool::KeyPool() : count_(0) {}
+
+KeyPool::~KeyPool() { clear(); }
+
+void KeyPool::grow() {
+  std::vector<JsonKey::Entry *> slots(slots_.empty() ? 64 : slots_.size() * 2,
+                                      static_cast<JsonKey::Entry *>(NULL));
+  size_t mask = slots.size() - 1;
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    if (!slots_[i])
+      continue;
+    size_t slot = slots_[i]->hash & mask;
+    while (slots[slot])
+      slot = (slot + 1) & mask;
+    slots[slot] = slots_[i];
+  }
+  slots_.swap(slots);
+}
+
+JsonKey KeyPool::intern(const char *data, size_t length) {
+  if ((count_ + 1) * 2 > slots_.size())
+    grow();
+  size_t h = JsonKey::hash(data, length);
+  size_t mask = slots_.size() - 1;
+  size_t slot = h & mask;
+  for (; slots_[slot]; slot = (slot + 1) & mask) {
+    const JsonKey::Entry *entry = slots_[slot];
+    if (entry->hash == h && entry->text.size() == length &&
+        std::memcmp(entry->text.data(), data, length) == 0)
+      return JsonKey(entry);
+  }
+  if (count_ == entries_.size())
+    entries_.push_back(JsonKey::Entry());
+  JsonKey::Entry *entry = &entries_[count_];
+  entry->text.assign(data, length);
+  entry->hash = h;
+  slots_[slot] = entry;
+  count_++;
+  return JsonKey(entry);
+}
+
+size_t KeyPool::size() const { return count_; }
+
+// With keepSlots the table keeps its size, emptied, and the entries are
+// kept for the next document.
+void KeyPool::clear(bool keepSlots) {
+  if (keepSlots) {
+    std::fill(slots_.begin(), slots_.end(),
+              static_cast<JsonKey::Entry *>(NULL));
+  } else {
+    slots_.clear();
+    entries_.clear();
+  }
+  count_ = 0;
+}
@@ -0,0 +1,118 @@
+#include "JsonLines.hpp"
+#include "JsonDocument.hpp"
+#include "scan.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <pthread.h>
+#include <stdexcept>
+#include <unistd.h>
+
+LineResult::LineResult() : line(0), valid(false) {}
+
+void JsonLines::split(const char *data, size_t length,
+                      std::vector<Line> &lines) {
+  const char *end = data + length;
+  size_t number = 1;
+  for (const char *p = data; p < end; ++number) {
+    const char *eol = static_cast<const char *>(std::memchr(p, '\n', end - p));
+    if (!eol)
+      eol = end;
+    if (skip_whitespace(p, eol) != eol) {
+      Line line = {p, static_cast<size_t>(eol - p), number};
+      lines.push_back(line);
+    }
+    p = eol + 1;
+  }
+}
+
+// Shared by the workers of one validate() call. Records are handed out in
+// batches under `lock`; each result slot is written by exactly one worker.
+struct LineJob {
+  const std::vector<JsonLines::Line> &lines;
+  std::vector<LineResult> &results;
+  const AJsonValidator &schema;
+  pthread_mutex_t lock;
+  size_t next;
+
+  static const size_t BATCH = 64;
+
+  LineJob(const std::vector<JsonLines::Line> &lines,
+          std::vector<LineResult> &results, const AJsonValidator &schema)
+      : lines(lines), results(results), schema(schema), next(0) {
+    pthread_mutex_init(&lock, NULL);
+  }
+  ~LineJob() { pthread_mutex_destroy(&lock); }
+
+  size_t take() {
+    pthread_mutex_lock(&lock);
+    size_t begin = next;
+    next += BATCH;
+    pthread_mutex_unlock(&lock);
+    return begin;
+  }
+};
+
+// Records are parsed into the compact representation of a document reused
+// by the worker, which validation only reads.
+static void validate_line(const JsonLines::Line &line, JsonDocument &doc,
+                          const AJsonValidator &schema, LineResult &result) {
+  result.line = line.number;
+  try {
+    const JsonValue &value = doc.parseCompact(line.data, line.length);
+    result.valid = schema.validate(&value, result.errors);
+  } catch (const std::exception &e) {
+    result.valid = false;
+    result.errors.push_back(ValidationError("", e.what()));
+  }
+}
+
+static void *validate_lines(void *arg) {
+  LineJob &job = *static_cast<LineJob *>(arg);
+  JsonDocument doc;
+
+  for (size_t begin = job.take(); begin < job.lines.size();
+       begin = job.take()) {
+    size_t end = std::min(begin + LineJob::BATCH, job.lines.size());
+    for (size_t i = begin; i < end; ++i)
+      validate_line(job.lines[i], doc, job.schema, job.results[i]);
+  }
+  return NULL;
+}
+
+void JsonLines::validate(const char *data, size_t length,
+                         const AJsonValidator &schema,
+                         std::vector<LineResult> &results, size_t threads) {
+  std::vector<Line> lines;
+  split(data, length, lines);
+  results.clear();
+  results.resize(lines.size());
+  if (!threads) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? cpus : 1;
+  }
+  threads = std::min(threads, (lines.size() + LineJob::BATCH - 1) /
+                                  LineJob::BATCH);
+
+  LineJob job(lines, results, schema);
+  std::vector<pthread_t> workers;
+  for (size_t i = 1; i < threads; ++i) {
+    pthread_t worker;
+    if (pthread_create(&worker, NULL, validate_lines, &job) != 0)
+      break;
+    workers.push_back(worker);
+  }
+  // The calling thread works too, and finishes alone if no thread started.
+  validate_lines(&job);
+  for (size_t i = 0; i < workers.size(); ++i)
+    pthread_join(workers[i], NULL);
+}
+
+void JsonLines::validateFile(const std::string &filename,
+                             const AJsonValidator &schema,
+                             std::vector<LineResult> &results,
+                             size_t threads) {
+  MappedFile file(filename);
+  validate(file.data(), file.size(), schema, results, threads);
+}
@@ -0,0 +1,228 @@
+#include "JsonMembers.hpp"
+#include <algorithm>
+
+static const size_t npos = static_cast<size_t>(-1);
+
+JsonMembers::JsonMembers(key_order order) : order_(order), pending_(false) {}
+
+JsonMembers::JsonMembers(const JsonMembers &obj)
+    : entries_(obj.entries_), index_(obj.index_), order_(obj.order_),
+      pending_(obj.pending_) {}
+
+JsonMembers &JsonMembers::operator=(const JsonMembers &obj) {
+  if (this != &obj) {
+    entries_ = obj.entries_;
+    index_ = obj.index_;
+    order_ = obj.order_;
+    pending_ = obj.pending_;
+  }
+  return *this;
+}
+
+// Returns the position of `key`, or npos. When the key is missing `hint` is
+// set to where it has to be inserted to keep the configured order.
+size_t JsonMembers::locate(const JsonKey &key, size_t &hint) const {
+  if (!index_.empty()) {
+    size_t mask = index_.size() - 1;
+    for (size_t slot = key.hash() & mask; index_[slot];
+         slot = (slot + 1) & mask) {
+      size_t pos = index_[slot] - 1;
+      if (entries_[pos].first == key)
+        return pos;
+    }
+    if (order_ == INSERTION_ORDER) {
+      hint = entries_.size();
+      return npos;
+    }
+  }
+  if (order_ == SORTED_KEYS) {
+    const std::string &text = key.str();
+    size_t lo = 0;
+    size_t hi = entries_.size();
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (entries_[mid].first.str() < text)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    hint = lo;
+    if (lo < entries_.size() && entries_[lo].first == key)
+      return lo;
+    return npos;
+  }
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    if (entries_[i].first == key)
+      return i;
+  }
+  hint = entries_.size();
+  return npos;
+}
+
+// Grows the vector by swapping the keys over instead of letting the C++98
+// std::vector copy every key on reallocation.
+void JsonMembers::reserveFor(size_t count) {
+  if (count <= entries_.capacity())
+    return;
+  std::vector<value_type> bigger;
+  bigger.reserve(std::max(count, entries_.capacity() * 2));
+  bigger.resize(entries_.size());
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    bigger[i].first.swap(entries_[i].first);
+    bigger[i].second = entries_[i].second;
+  }
+  entries_.swap(bigger);
+}
+
+size_t JsonMembers::insertAt(size_t pos, const JsonKey &key) {
+  reserveFor(entries_.size() + 1);
+  entries_.push_back(value_type());
+  for (size_t i = entries_.size() - 1; i > pos; --i) {
+    entries_[i].first.swap(entries_[i - 1].first);
+    entries_[i].second = entries_[i - 1].second;
+  }
+  entries_[pos].first = key;
+  entries_[pos].second = NULL;
+  if (!index_.empty() && entries_.size() * 2 <= index_.size()) {
+    if (pos + 1 != entries_.size())
+      shiftIndex(pos);
+    indexEntry(pos);
+  } else if (!index_.empty() || entries_.size() > INDEX_THRESHOLD)
+    rebuildIndex();
+  return pos;
+}
+
+// Moves the indexed positions past the entry inserted at `pos`, before it
+// is indexed itself.
+void JsonMembers::shiftIndex(size_t pos) {
+  for (size_t slot = 0; slot < index_.size(); ++slot)
+    if (index_[slot] > pos)
+      ++index_[slot];
+}
+
+void JsonMembers::indexEntry(size_t pos) {
+  size_t mask = index_.size() - 1;
+  size_t slot = entries_[pos].first.hash() & mask;
+  while (index_[slot])
+    slot = (slot + 1) & mask;
+  index_[slot] = pos + 1;
+}
+
+// Keeps the table at most half full.
+void JsonMembers::rebuildIndex() {
+  size_t capacity = 16;
+  while (capacity < entries_.size() * 2)
+    capacity *= 2;
+  index_.assign(capacity, 0);
+  for (size_t i = 0; i < entries_.size(); ++i)
+    indexEntry(i);
+}
+
+key_order JsonMembers::order() const { return order_; }
+size_t JsonMembers::size() const { return entries_.size(); }
+bool JsonMembers::empty() const { return entries_.empty(); }
+JsonMembers::iterator JsonMembers::begin() { return entries_.begin(); }
+JsonMembers::const_iterator JsonMembers::begin() const {
+  return entries_.begin();
+}
+JsonMembers::iterator JsonMembers::end() { return entries_.end(); }
+JsonMembers::const_iterator JsonMembers::end() const { return entries_.end(); }
+
+JsonMembers::iterator JsonMembers::find(const std::string &key) {
+  return find(JsonKey(key));
+}
+
+JsonMembers::const_iterator JsonMembers::find(const std::string &key) const {
+  return find(JsonKey(key));
+}
+
+JsonMembers::iterator JsonMembers::find(const JsonKey &key) {
+  size_t hint;
+  size_t pos = locate(key, hint);
+  return pos == npos ? entries_.end() : entries_.begin() + pos;
+}
+
+JsonMembers::const_iterator JsonMembers::find(const JsonKey &key) const {
+  size_t hint;
+  size_t pos = locate(key, hint);
+  return pos == npos ? entries_.end() : entries_.begin() + pos;
+}
+
+AJsonValue *&JsonMembers::operator[](const std::string &key) {
+  return (*this)[JsonKey(key)];
+}
+
+AJsonValue *&JsonMembers::operator[](const JsonKey &key) {
+  size_t hint = 0;
+  size_t pos = locate(key, hint);
+  if (pos == npos)
+    pos = insertAt(hint, key);
+  return entries_[pos].second;
+}
+
+// In insertion order this is operator[], and the value the member had is
+// returned. In sorted mode the member is only added at the end, duplicate
+// keys included, and finish() sorts them out.
+AJsonValue *JsonMembers::append(const JsonKey &key, AJsonValue *value) {
+  if (order_ == INSERTION_ORDER) {
+    AJsonValue *&slot = (*this)[key];
+    AJsonValue *previous = slot;
+    slot = value;
+    return previous;
+  }
+  reserveFor(entries_.size() + 1);
+  entries_.push_back(value_type(key, value));
+  pending_ = true;
+  return NULL;
+}
+
+// Orders positions in `entries` by their keys.
+struct PositionLess {
+  const std::vector<JsonMembers::value_type> &entries;
+
+  bool operator()(size_t a, size_t b) const {
+    return entries[a].first.str() < entries[b].first.str();
+  }
+};
+
+// Sorts the appended members by key, stable so that of duplicate keys the
+// last one wins as it would through operator[]; the values it replaces are
+// handed back in `replaced`. Keys already in order skip the sort.
+void JsonMembers::finish(std::vector<AJsonValue *> &replaced) {
+  if (!pending_)
+    return;
+  size_t count = entries_.size();
+  size_t i = 1;
+  while (i < count && entries_[i - 1].first.str() < entries_[i].first.str())
+    ++i;
+  if (i < count) {
+    std::vector<size_t> order(count);
+    for (i = 0; i < count; ++i)
+      order[i] = i;
+    PositionLess less = {entries_};
+    std::stable_sort(order.begin(), order.end(), less);
+    std::vector<value_type> sorted(count);
+    size_t kept = 0;
+    for (i = 0; i < count; ++i) {
+      value_type &entry = entries_[order[i]];
+      if (i + 1 < count && entries_[order[i + 1]].first == entry.first) {
+        replaced.push_back(entry.second);
+        continue;
+      }
+      sorted[kept].first.swap(entry.first);
+      sorted[kept++].second = entry.second;
+    }
+    sorted.resize(kept);
+    entries_.swap(sorted);
+  }
+  index_.clear();
+  if (entries_.size() > INDEX_THRESHOLD)
+    rebuildIndex();
+  pending_ = false;
+}
+
+void JsonMembers::clear() {
+  entries_.clear();
+  index_.clear();
+  pending_ = false;
+}
@@ -0,0 +1,31 @@
+#include "JsonParser.hpp"
+
+JsonParser::JsonParser(const ParseOptions &options)
+    : options_(options), root_(NULL) {}
+
+JsonParser::~JsonParser() { clear(); }
+
+AJsonValue *JsonParser::parse(const char *data, size_t length) {
+  AJsonValue::release(root_);
+  root_ = NULL;
+  doc_.clear(true);
+  root_ = Json::parse_raw(data, length, options_, &doc_, buffers_);
+  return root_;
+}
+
+AJsonValue *JsonParser::parse(const std::string &raw) {
+  return parse(raw.data(), raw.size());
+}
+
+AJsonValue *JsonParser::parse(const char *data, size_t length,
+                              JsonDocument *doc) {
+  return Json::parse_raw(data, length, options_, doc, buffers_);
+}
+
+ParseOptions &JsonParser::options() { return options_; }
+
+void JsonParser::clear() {
+  AJsonValue::release(root_);
+  root_ = NULL;
+  doc_.clear();
+}
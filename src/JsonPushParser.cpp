@@ -0,0 +1,250 @@
+#include "JsonPushParser.hpp"
+#include "JsonHandler.hpp"
+#include "scan.hpp"
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+static void malformed() { throw std::runtime_error("Malformed JSON file!"); }
+
+static void too_deep() {
+  throw std::runtime_error("Maximum nesting depth exceeded!");
+}
+
+static bool emit_scalar(const token &tk, JsonHandler &handler) {
+  switch (tk.type) {
+  case TK_STRING:
+    return handler.onString(tk.token);
+  case TK_NUMBER:
+    return handler.onNumber(tk.number);
+  case TK_DOUBLE:
+    return handler.onDouble(tk.real);
+  case TK_BOOLEAN:
+    return handler.onBool(tk.token == "true");
+  case TK_NIL:
+    return handler.onNull();
+  default:
+    malformed();
+  }
+  return false;
+}
+
+// Whether [p, end) is a proper prefix of some token, i.e. a token the
+// tokenizer rejected only because the input stopped.
+static bool may_continue(const char *p, const char *end) {
+  static const char *const literals[] = {"true", "false", "null"};
+  size_t length = end - p;
+
+  if (*p == '"')
+    return true;
+  for (size_t i = 0; i < 3; ++i) {
+    if (length < std::strlen(literals[i]) &&
+        std::memcmp(p, literals[i], length) == 0)
+      return true;
+  }
+  if (*p != '-' && !isdigit(static_cast<unsigned char>(*p)))
+    return false;
+  const char *q = p + 1;
+  while (q < end && isdigit(static_cast<unsigned char>(*q)))
+    q++;
+  if (q < end && *q == '.')
+    q++;
+  while (q < end && isdigit(static_cast<unsigned char>(*q)))
+    q++;
+  if (q < end && (*q == 'e' || *q == 'E'))
+    q++;
+  if (q < end && (*q == '+' || *q == '-'))
+    q++;
+  while (q < end && isdigit(static_cast<unsigned char>(*q)))
+    q++;
+  return q == end;
+}
+
+JsonPushParser::JsonPushParser(JsonHandler &handler, size_t maxDepth)
+    : handler_(handler), maxDepth_(maxDepth) {
+  reset();
+}
+
+void JsonPushParser::reset() {
+  open_.clear();
+  pending_.clear();
+  state_ = ROOT;
+  stopped_ = false;
+  ended_ = false;
+}
+
+bool JsonPushParser::done() const { return state_ == DONE; }
+
+// Number of leading bytes of `data` that belong to the pending token.
+// `complete` tells whether the token ends there; otherwise all of `data`
+// belongs to it and it may still grow.
+size_t JsonPushParser::continuation(const char *data, size_t length,
+                                    bool &complete) const {
+  const char *end = data + length;
+  complete = false;
+  if (pending_[0] != '"') {
+    const char *p = data;
+    while (p < end && (isalnum(static_cast<unsigned char>(*p)) || *p == '.' ||
+                       *p == '-' || *p == '+'))
+      p++;
+    complete = p < end;
+    return p - data;
+  }
+  // An odd run of backslashes at the end escapes the first byte of `data`.
+  size_t run = 0;
+  while (run + 1 < pending_.size() &&
+         pending_[pending_.size() - 1 - run] == '\\')
+    run++;
+  const char *p = data;
+  if (run % 2 && p < end)
+    p++;
+  for (;;) {
+    p = find_string_special(p, end);
+    if (p == end)
+      return length;
+    if (*p == '"') {
+      complete = true;
+      return p + 1 - data;
+    }
+    if (++p == end)
+      return length;
+    p++;
+  }
+}
+
+bool JsonPushParser::feed(const char *data, size_t length) {
+  if (stopped_ || ended_)
+    return !stopped_;
+  if (!pending_.empty()) {
+    // A token spanning many chunks is only tokenized once it is complete.
+    bool complete;
+    size_t used = continuation(data, length, complete);
+    pending_.append(data, used);
+    if (!complete)
+      return true;
+    std::string token;
+    token.swap(pending_);
+    if (!consume(token.data(), token.data() + token.size(), true))
+      return false;
+    data += used;
+    length -= used;
+  }
+  return consume(data, data + length, false);
+}
+
+bool JsonPushParser::feed(const std::string &chunk) {
+  return feed(chunk.data(), chunk.size());
+}
+
+bool JsonPushParser::finish() {
+  if (stopped_)
+    return false;
+  if (!pending_.empty()) {
+    std::string token;
+    token.swap(pending_);
+    if (!consume(token.data(), token.data() + token.size(), true))
+      return false;
+  }
+  if (state_ != ROOT && state_ != DONE)
+    malformed();
+  return true;
+}
+
+// Runs the tokens of [begin, end) through the grammar. Unless `last` is
+// set, a token reaching `end` may still grow and is kept in pending_.
+bool JsonPushParser::consume(const char *begin, const char *end, bool last) {
+  Tokenizer tz(begin, end);
+  for (;;) {
+    const char *start = skip_whitespace(begin + tz.offset(), end);
+    if (start == end || ended_)
+      return true;
+    tz.seek(start - begin);
+    tz.next(tk_);
+    if (tk_.type == END) {
+      // A NUL byte ends the document, as it does for Json::parse.
+      ended_ = true;
+      return true;
+    }
+    bool open = tk_.type == TK_NUMBER || tk_.type == TK_DOUBLE
+                    ? begin + tz.offset() == end
+                    : tk_.type == TK_UNDEFINED && may_continue(start, end);
+    if (open && !last) {
+      pending_.assign(start, end - start);
+      return true;
+    }
+    if (!push(tk_)) {
+      stopped_ = true;
+      return false;
+    }
+  }
+}
+
+// One step of the grammar of Json::parse. Every state rejects the tokens it
+// does not expect, TK_UNDEFINED included.
+bool JsonPushParser::push(const token &tk) {
+  switch (state_) {
+  case ROOT:
+    if (tk.type != CB_OPEN && tk.type != SB_OPEN)
+      malformed();
+    return value(tk);
+  case VALUE:
+    return value(tk);
+  case FIRST_ELEMENT:
+    if (tk.type == SB_CLOSE)
+      return close(tk);
+    return value(tk);
+  case ELEMENT:
+    if (tk.type == SB_CLOSE)
+      malformed();
+    return value(tk);
+  case FIRST_KEY:
+    if (tk.type == CB_CLOSE)
+      return close(tk);
+    // fall through
+  case KEY:
+    if (tk.type != TK_STRING)
+      malformed();
+    state_ = AFTER_KEY;
+    return handler_.onKey(tk.token);
+  case AFTER_KEY:
+    if (tk.type != COLON)
+      malformed();
+    state_ = VALUE;
+    return true;
+  case NEXT:
+    if (tk.type == COMMA) {
+      state_ = open_.back() == CB_OPEN ? KEY : ELEMENT;
+      return true;
+    }
+    return close(tk);
+  default:
+    malformed();
+  }
+  return false;
+}
+
+bool JsonPushParser::value(const token &tk) {
+  if ((tk.type == CB_OPEN || tk.type == SB_OPEN) && open_.size() >= maxDepth_)
+    too_deep();
+  if (tk.type == CB_OPEN) {
+    open_.push_back(CB_OPEN);
+    state_ = FIRST_KEY;
+    return handler_.onObjectStart();
+  }
+  if (tk.type == SB_OPEN) {
+    open_.push_back(SB_OPEN);
+    state_ = FIRST_ELEMENT;
+    return handler_.onArrayStart();
+  }
+  state_ = NEXT;
+  return emit_scalar(tk, handler_);
+}
+
+bool JsonPushParser::close(const token &tk) {
+  bool object = open_.back() == CB_OPEN;
+  if (tk.type != (object ? CB_CLOSE : SB_CLOSE))
+    malformed();
+  open_.pop_back();
+  state_ = open_.empty() ? DONE : NEXT;
+  return object ? handler_.onObjectEnd() : handler_.onArrayEnd();
+}
@@ -1,114 +1,291 @@
 #include "JsonTypes.hpp"
 #include "AJsonValue.hpp"
-
-JsonString::JsonString() {}
-JsonString::JsonString(std::string value) : value(value) {}
-JsonString::JsonString(const JsonString &obj) : value(obj.value) {}
+#include <utility>
+#include <vector>
+
+JsonString::JsonString() : AJsonValue(STRING), view_(NULL), viewLength_(0) {}
+JsonString::JsonString(std::string value)
+    : AJsonValue(STRING), view_(NULL), viewLength_(0), value(value) {}
+JsonString::JsonString(const char *data, size_t length)
+    : AJsonValue(STRING), view_(data), viewLength_(length) {}
+JsonString::JsonString(const JsonString &obj)
+    : AJsonValue(obj), view_(NULL), viewLength_(0), value(obj.str()) {}
+
+bool JsonString::isView() const { return view_ != NULL; }
+const char *JsonString::data() const { return view_ ? view_ : value.data(); }
+size_t JsonString::size() const { return view_ ? viewLength_ : value.size(); }
+std::string JsonString::str() const {
+  return view_ ? std::string(view_, viewLength_) : value;
+}
 
 AJsonValue *JsonString::clone() const { return new JsonString(*this); }
 
+static bool same_text(const JsonString &a, const JsonString &b) {
+  return a.size() == b.size() &&
+         std::char_traits<char>::compare(a.data(), b.data(), a.size()) == 0;
+}
+
 bool JsonString::isEqual(const AJsonValue &other) const {
-  const JsonString &otherValue = dynamic_cast<const JsonString &>(other);
-  return value == otherValue.value;
+  if (other.getType() != STRING)
+    return false;
+  return same_text(*this, static_cast<const JsonString &>(other));
 }
 
 bool JsonString::isEqual(AJsonValue &other) {
-  JsonString &otherValue = dynamic_cast<JsonString &>(other);
-  return value == otherValue.value;
+  if (other.getType() != STRING)
+    return false;
+  return same_text(*this, static_cast<JsonString &>(other));
 }
 
-JsonNumber::JsonNumber() : value(0) {}
-JsonNumber::JsonNumber(long value) : value(value) {}
-JsonNumber::JsonNumber(std::string value) : value(std::atol(value.c_str())) {}
-JsonNumber::JsonNumber(const JsonNumber &obj) : value(obj.value) {}
+JsonNumber::JsonNumber() : AJsonValue(NUMBER), value(0) {}
+JsonNumber::JsonNumber(long value) : AJsonValue(NUMBER), value(value) {}
+JsonNumber::JsonNumber(std::string value)
+    : AJsonValue(NUMBER), value(std::atol(value.c_str())) {}
+JsonNumber::JsonNumber(const JsonNumber &obj)
+    : AJsonValue(obj), value(obj.value) {}
 
 AJsonValue *JsonNumber::clone() const { return new JsonNumber(*this); }
 
 bool JsonNumber::isEqual(const AJsonValue &other) const {
-  const JsonNumber &otherValue = dynamic_cast<const JsonNumber &>(other);
+  if (other.getType() != NUMBER)
+    return false;
+  const JsonNumber &otherValue = static_cast<const JsonNumber &>(other);
   return value == otherValue.value;
 }
 
 bool JsonNumber::isEqual(AJsonValue &other) {
-  JsonNumber &otherValue = dynamic_cast<JsonNumber &>(other);
+  if (other.getType() != NUMBER)
+    return false;
+  JsonNumber &otherValue = static_cast<JsonNumber &>(other);
   return value == otherValue.value;
 }
 
-JsonDouble::JsonDouble() : value(0) {}
-JsonDouble::JsonDouble(std::string value) : value(std::atof(value.c_str())) {}
-JsonDouble::JsonDouble(const JsonDouble &obj) : value(obj.value) {}
+JsonDouble::JsonDouble() : AJsonValue(DOUBLE), value(0) {}
+JsonDouble::JsonDouble(double value) : AJsonValue(DOUBLE), value(value) {}
+JsonDouble::JsonDouble(std::string value)
+    : AJsonValue(DOUBLE), value(std::atof(value.c_str())) {}
+JsonDouble::JsonDouble(const JsonDouble &obj)
+    : AJsonValue(obj), value(obj.value) {}
 
 AJsonValue *JsonDouble::clone() const { return new JsonDouble(*this); }
 
 bool JsonDouble::isEqual(const AJsonValue &other) const {
-  const JsonDouble &otherValue = dynamic_cast<const JsonDouble &>(other);
+  if (other.getType() != DOUBLE)
+    return false;
+  const JsonDouble &otherValue = static_cast<const JsonDouble &>(other);
   return value == otherValue.value;
 }
 
 bool JsonDouble::isEqual(AJsonValue &other) {
-  JsonDouble &otherValue = dynamic_cast<JsonDouble &>(other);
+  if (other.getType() != DOUBLE)
+    return false;
+  JsonDouble &otherValue = static_cast<JsonDouble &>(other);
   return value == otherValue.value;
 }
 
-JsonNull::JsonNull() : value(NULL) {}
-JsonNull::JsonNull(const JsonNull &obj) : value(obj.value) {}
+JsonNull::JsonNull() : AJsonValue(NIL), value(NULL) {}
+JsonNull::JsonNull(const JsonNull &obj) : AJsonValue(obj), value(obj.value) {}
 
 AJsonValue *JsonNull::clone() const { return new JsonNull(*this); }
 
 bool JsonNull::isEqual(const AJsonValue &other) const {
-  const JsonNull &otherValue = dynamic_cast<const JsonNull &>(other);
+  if (other.getType() != NIL)
+    return false;
+  const JsonNull &otherValue = static_cast<const JsonNull &>(other);
   return value == otherValue.value;
 }
 
 bool JsonNull::isEqual(AJsonValue &other) {
-  JsonNull &otherValue = dynamic_cast<JsonNull &>(other);
+  if (other.getType() != NIL)
+    return false;
+  JsonNull &otherValue = static_cast<JsonNull &>(other);
   return value == otherValue.value;
 }
 
-JsonBool::JsonBool() : value(0) {}
-JsonBool::JsonBool(bool value) : value(value) {}
-JsonBool::JsonBool(std::string value) : value(value == "true") {}
-JsonBool::JsonBool(const JsonBool &obj) : value(obj.value) {}
+JsonBool::JsonBool() : AJsonValue(BOOLEAN), value(0) {}
+JsonBool::JsonBool(bool value) : AJsonValue(BOOLEAN), value(value) {}
+JsonBool::JsonBool(std::string value)
+    : AJsonValue(BOOLEAN), value(value == "true") {}
+JsonBool::JsonBool(const JsonBool &obj) : AJsonValue(obj), value(obj.value) {}
 
 AJsonValue *JsonBool::clone() const { return new JsonBool(*this); }
 
 bool JsonBool::isEqual(const AJsonValue &other) const {
-  const JsonBool &otherValue = dynamic_cast<const JsonBool &>(other);
+  if (other.getType() != BOOLEAN)
+    return false;
+  const JsonBool &otherValue = static_cast<const JsonBool &>(other);
   return value == otherValue.value;
 }
 
 bool JsonBool::isEqual(AJsonValue &other) {
-  JsonBool &otherValue = dynamic_cast<JsonBool &>(other);
+  if (other.getType() != BOOLEAN)
+    return false;
+  JsonBool &otherValue = static_cast<JsonBool &>(other);
   return value == otherValue.value;
 }
 
-JsonObject::JsonObject() {}
+// Trees are destroyed, copied and compared without recursion, whatever their
+// depth: the children still to be handled wait on a heap allocated work list.
+
+// Moves the children of `value` to `pending`, leaving it empty.
+static void take_children(AJsonValue *value,
+                          std::vector<AJsonValue *> &pending) {
+  if (JsonObject *object = value->asObject()) {
+    for (JsonObject::iterator it = object->begin(); it != object->end(); ++it)
+      pending.push_back(it->second);
+    object->members.clear();
+  } else if (JsonArray *array = value->asArray()) {
+    pending.insert(pending.end(), array->elements.begin(),
+                   array->elements.end());
+    array->elements.clear();
+  }
+}
+
+// Releases the children of `value`. Each one is emptied before it is
+// released, so its own destructor has nothing left to do.
+static void release_children(AJsonValue *value) {
+  std::vector<AJsonValue *> pending;
+  take_children(value, pending);
+  while (!pending.empty()) {
+    AJsonValue *child = pending.back();
+    pending.pop_back();
+    if (!child)
+      continue;
+    take_children(child, pending);
+    AJsonValue::release(child);
+  }
+}
+
+typedef std::vector<std::pair<const AJsonValue *, AJsonValue *> > CopyList;
+
+// A scalar is cloned; a container is copied empty and queued in `pending`
+// to receive copies of its children.
+static AJsonValue *shallow_copy(const AJsonValue *value, CopyList &pending) {
+  AJsonValue *copy;
+  if (!value)
+    return NULL;
+  else if (const JsonObject *object = value->asObject())
+    copy = new JsonObject(object->order());
+  else if (value->isArray())
+    copy = new JsonArray();
+  else
+    return value->clone();
+  pending.push_back(std::make_pair(value, copy));
+  return copy;
+}
+
+// Fills `copy` with a deep copy of the children of `source`. On failure
+// `copy` is emptied again.
+static void copy_children(const AJsonValue &source, AJsonValue &copy) {
+  CopyList pending(1, std::make_pair(&source, &copy));
+  try {
+    while (!pending.empty()) {
+      const AJsonValue *from = pending.back().first;
+      AJsonValue *to = pending.back().second;
+      pending.pop_back();
+      if (const JsonObject *object = from->asObject()) {
+        JsonObject &target = *to->asObject();
+        for (JsonObject::const_iterator it = object->begin();
+             it != object->end(); ++it)
+          target.members[it->first.str()] = shallow_copy(it->second, pending);
+      } else {
+        const JsonArray &array = *from->asArray();
+        JsonArray &target = *to->asArray();
+        target.elements.reserve(array.elements.size());
+        for (size_t i = 0; i < array.elements.size(); ++i)
+          target.elements.push_back(shallow_copy(array.elements[i], pending));
+      }
+    }
+  } catch (...) {
+    release_children(&copy);
+    throw;
+  }
+}
+
+typedef std::vector<std::pair<const AJsonValue *, const AJsonValue *> >
+    CompareList;
+
+// Deep comparison. Object members are matched by key: with INSERTION_ORDER
+// two equal objects may list them differently.
+static bool same_tree(const AJsonValue &a, const AJsonValue &b) {
+  CompareList pending(1, std::make_pair(&a, &b));
+  while (!pending.empty()) {
+    const AJsonValue *x = pending.back().first;
+    const AJsonValue *y = pending.back().second;
+    pending.pop_back();
+    if (x == y)
+      continue;
+    if (!x || !y || x->getType() != y->getType())
+      return false;
+    if (const JsonObject *object = x->asObject()) {
+      const JsonObject &other = *y->asObject();
+      if (object->size() != other.size())
+        return false;
+      for (JsonObject::const_iterator it = object->begin();
+           it != object->end(); ++it) {
+        JsonObject::const_iterator otherIt = other.members.find(it->first);
+        if (otherIt == other.end())
+          return false;
+        pending.push_back(std::make_pair(it->second, otherIt->second));
+      }
+    } else if (const JsonArray *array = x->asArray()) {
+      const JsonArray &other = *y->asArray();
+      if (array->size() != other.size())
+        return false;
+      for (size_t i = 0; i < array->size(); ++i)
+        pending.push_back(
+            std::make_pair(array->elements[i], other.elements[i]));
+    } else if (!x->isEqual(*y))
+      return false;
+  }
+  return true;
+}
+
+JsonObject::JsonObject() : AJsonValue(OBJECT) {}
+JsonObject::JsonObject(key_order order) : AJsonValue(OBJECT), members(order) {}
 
 AJsonValue &JsonObject::operator[](const std::string &item) {
-  return *(this->members[item]);
+  static JsonNull null;
+  iterator it = members.find(item);
+  if (it == members.end() || !it->second)
+    return null;
+  return *it->second;
 }
 
-JsonObject::JsonObject(const JsonObject &obj) {
-  const_iterator it = obj.begin();
-  for (; it != obj.end(); it++)
-    members[it->first] = it->second->clone();
+JsonObject::JsonObject(const JsonObject &obj)
+    : AJsonValue(obj), members(obj.members.order()) {
+  copy_children(obj, *this);
 }
 
+key_order JsonObject::order() const { return members.order(); }
+
 void JsonObject::setProperty(const std::string &key, AJsonValue *value) {
-  std::map<std::string, AJsonValue *>::iterator it = members.find(key);
-  if (it != members.end())
-    delete it->second;
-  members[key] = value;
+  AJsonValue *&slot = members[key];
+  release(slot);
+  slot = value;
+}
+
+void JsonObject::setProperty(const JsonKey &key, AJsonValue *value) {
+  AJsonValue *&slot = members[key];
+  release(slot);
+  slot = value;
 }
 
 void JsonObject::replaceProperty(const std::string &key, AJsonValue *value) {
-  std::map<std::string, AJsonValue *>::iterator it = members.find(key);
-  if (it != members.end()) {
-    delete it->second;
-    it->second = value;
-  } else {
-    members[key] = value;
-  }
+  setProperty(key, value);
+}
+
+// For parsers: adds the member through JsonMembers::append(), after which
+// finishProperties() must be called once the object is complete.
+void JsonObject::appendProperty(const JsonKey &key, AJsonValue *value) {
+  release(members.append(key, value));
+}
+
+void JsonObject::finishProperties() {
+  std::vector<AJsonValue *> replaced;
+  members.finish(replaced);
+  for (size_t i = 0; i < replaced.size(); ++i)
+    release(replaced[i]);
 }
 
 AJsonValue *JsonObject::clone() const { return new JsonObject(*this); }
@@ -125,53 +302,20 @@ JsonObject::const_iterator JsonObject::find(std::string &key) const {
 }
 
 bool JsonObject::isEqual(const AJsonValue &other) const {
-  const JsonObject &otherObj = dynamic_cast<const JsonObject &>(other);
-
-  if (members.size() != otherObj.members.size())
+  if (other.getType() != OBJECT)
     return false;
-
-  const_iterator it = members.begin();
-  const_iterator otherIt = otherObj.members.begin();
-
-  for (; it != members.end(); ++it, ++otherIt) {
-    if (it->first != otherIt->first)
-      return false;
-    if (it->second == otherIt->second)
-      continue;
-    if (!it->second || !otherIt->second || !(*it->second == *otherIt->second))
-      return false;
-  }
-  return true;
+  return same_tree(*this, other);
 }
 
 bool JsonObject::isEqual(AJsonValue &other) {
-  JsonObject &otherObj = dynamic_cast<JsonObject &>(other);
-
-  if (members.size() != otherObj.members.size())
+  if (other.getType() != OBJECT)
     return false;
-
-  const_iterator it = members.begin();
-  const_iterator otherIt = otherObj.members.begin();
-
-  for (; it != members.end(); ++it, ++otherIt) {
-    if (it->first != otherIt->first)
-      return false;
-    if (it->second == otherIt->second)
-      continue;
-    if (!it->second || !otherIt->second || !(*it->second == *otherIt->second))
-      return false;
-  }
-  return true;
+  return same_tree(*this, other);
 }
 
-JsonObject::~JsonObject() {
-  container::iterator it = members.begin();
-  for (; it != members.end(); it++) {
-    delete it->second;
-  }
-}
+JsonObject::~JsonObject() { release_children(this); }
 
-JsonArray::JsonArray() {}
+JsonArray::JsonArray() : AJsonValue(ARRAY) {}
 
 AJsonValue &JsonArray::operator[](const unsigned long &idx) {
   return *(this->elements[idx]);
@@ -179,10 +323,8 @@ AJsonValue &JsonArray::operator[](const unsigned long &idx) {
 
 AJsonValue *JsonArray::clone() const { return new JsonArray(*this); }
 
-JsonArray::JsonArray(const JsonArray &obj) {
-  const_iterator it = obj.begin();
-  for (; it != obj.end(); it++)
-    elements.push_back((*it)->clone());
+JsonArray::JsonArray(const JsonArray &obj) : AJsonValue(obj) {
+  copy_children(obj, *this);
 }
 
 size_t JsonArray::size() const { return elements.size(); }
@@ -193,41 +335,15 @@ JsonArray::iterator JsonArray::end() { return elements.end(); }
 JsonArray::const_iterator JsonArray::end() const { return elements.end(); }
 
 bool JsonArray::isEqual(const AJsonValue &other) const {
-  const JsonArray &otherArray = dynamic_cast<const JsonArray &>(other);
-
-  if (elements.size() != otherArray.elements.size())
+  if (other.getType() != ARRAY)
     return false;
-
-  for (size_t i = 0; i < elements.size(); ++i) {
-    AJsonValue *val1 = elements[i];
-    AJsonValue *val2 = otherArray.elements[i];
-
-    if ((val1 == NULL) != (val2 == NULL))
-      return false;
-
-    if (val1 && val2 && !(*val1 == *val2))
-      return false;
-  }
-  return true;
+  return same_tree(*this, other);
 }
 
 bool JsonArray::isEqual(AJsonValue &other) {
-  JsonArray &otherArray = dynamic_cast<JsonArray &>(other);
-
-  if (elements.size() != otherArray.elements.size())
+  if (other.getType() != ARRAY)
     return false;
-
-  for (size_t i = 0; i < elements.size(); ++i) {
-    AJsonValue *val1 = elements[i];
-    AJsonValue *val2 = otherArray.elements[i];
-
-    if ((val1 == NULL) != (val2 == NULL))
-      return false;
-
-    if (val1 && val2 && !(*val1 == *val2))
-      return false;
-  }
-  return true;
+  return same_tree(*this, other);
 }
 
 AJsonValue &JsonArray::find(std::string item) {
@@ -243,8 +359,4 @@ AJsonValue &JsonArray::find(std::string item) {
   return null;
 }
 
-JsonArray::~JsonArray() {
-  for (unsigned long i = 0; i < elements.size(); i++) {
-    delete elements[i];
-  }
-}
+JsonArray::~JsonArray() { release_children(this); }
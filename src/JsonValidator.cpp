@@ -1,12 +1,62 @@
 #include "JsonValidator.hpp"
 #include "AJsonValue.hpp"
 #include "JsonTypes.hpp"
+#include "JsonValue.hpp"
+#include "adapters.hpp"
 #include "utils.hpp"
 #include "validators.hpp"
+#include <algorithm>
+
+static const size_t NO_LIMIT = static_cast<size_t>(-1);
 
 ValidationError::ValidationError(const std::string &p, const std::string &m)
     : path(p), msg(m) {}
 
+SchemaPath SchemaPath::start(const std::string &path) {
+  SchemaPath start = {ROOT, NULL, &path, NULL, 0};
+  return start;
+}
+
+SchemaPath SchemaPath::child(kind segment, const char *key,
+                             size_t size) const {
+  SchemaPath child = {segment, this, NULL, key, size};
+  return child;
+}
+
+// Spelled as the validators always have: "a.b" for a property, "a.<k>" for
+// a matched key, "a[0]" for an item and "[]a" for the size of an array.
+std::string SchemaPath::str() const {
+  if (what == ROOT)
+    return *root;
+  std::string path = parent->str();
+  std::string key(name ? name : "", name ? length : 0);
+  switch (what) {
+  case PROPERTY:
+    return path.empty() ? key : path + "." + key;
+  case MATCH:
+    return (path.empty() ? key : path + ".<" + key) + '>';
+  case ITEM:
+    return path + "[" + to_string(length) + "]";
+  default:
+    return "[]" + path;
+  }
+}
+
+ValidateOptions::ValidateOptions() : maxErrors(0) {}
+
+void ErrorSink::add(const SchemaPath &path, const std::string &msg) {
+  list.push_back(ValidationError(path.str(), msg));
+}
+
+// The limit counts from the errors already in the list, which are kept.
+static ErrorSink sink_for(std::vector<ValidationError> &errors,
+                          const ValidateOptions &options) {
+  ErrorSink sink = {errors, options.maxErrors
+                                ? errors.size() + options.maxErrors
+                                : NO_LIMIT};
+  return sink;
+}
+
 AJsonValidator::AJsonValidator()
     : optional_(false), hasDefault_(false), exceptedType_(UNDEFINED),
       defaultValue_(NULL) {}
@@ -15,6 +65,56 @@ AJsonValidator::AJsonValidator(const AJsonValidator &obj)
     : optional_(obj.optional_), hasDefault_(obj.hasDefault_),
       exceptedType_(obj.exceptedType_), defaultValue_(obj.defaultValue_) {}
 
+bool AJsonValidator::validate(const AJsonValue *v,
+                              const ValidateOptions &options,
+                              const std::string &path) {
+  return validate(v, errors_, options, path);
+}
+
+bool AJsonValidator::validate(const JsonValue *v,
+                              const ValidateOptions &options,
+                              const std::string &path) {
+  return validate(v, errors_, options, path);
+}
+
+// Defaults are filled in before validating, so they are validated too.
+bool AJsonValidator::validate(AJsonValue *v, const std::string &path) {
+  if (v)
+    applyDefaults(v);
+  return validate(static_cast<const AJsonValue *>(v), path);
+}
+
+bool AJsonValidator::validate(AJsonValue *v, const ValidateOptions &options,
+                              const std::string &path) {
+  if (v)
+    applyDefaults(v);
+  return validate(static_cast<const AJsonValue *>(v), errors_, options, path);
+}
+
+bool AJsonValidator::validate(const AJsonValue *v, ValidationErr &errors,
+                              const std::string &path) const {
+  return validate(v, errors, ValidateOptions(), path);
+}
+
+bool AJsonValidator::validate(const JsonValue *v, ValidationErr &errors,
+                              const std::string &path) const {
+  return validate(v, errors, ValidateOptions(), path);
+}
+
+bool AJsonValidator::validate(const AJsonValue *v, ValidationErr &errors,
+                              const ValidateOptions &options,
+                              const std::string &path) const {
+  ErrorSink sink = sink_for(errors, options);
+  return validateAt(*v, SchemaPath::start(path), sink);
+}
+
+bool AJsonValidator::validate(const JsonValue *v, ValidationErr &errors,
+                              const ValidateOptions &options,
+                              const std::string &path) const {
+  ErrorSink sink = sink_for(errors, options);
+  return validateAt(*v, SchemaPath::start(path), sink);
+}
+
 AJsonValue *AJsonValidator::get_default() const {
   return defaultValue_ ? defaultValue_->clone() : NULL;
 }
@@ -53,6 +153,11 @@ bool AJsonValidator::isTypeCompatible(const AJsonValidator &v,
   return j->getType() == v.exceptedType_;
 }
 
+bool AJsonValidator::isTypeCompatible(const AJsonValidator &v,
+                                      const JsonValue *j) const {
+  return j->getType() == v.exceptedType_;
+}
+
 ObjectValidator &ObjectValidator::optional() {
   if (last_)
     last_->set_optional();
@@ -75,17 +180,70 @@ void AJsonValidator::addError(const std::string &path, const std::string &msg) {
   errors_.push_back(ValidationError(path, msg));
 }
 
+// The clone starts without errors and knows nothing of the limit, so only
+// the room left in the sink is taken from its list.
+template <typename Node>
+static bool validate_clone(const AJsonValidator &validator, const Node &v,
+                           const SchemaPath &path, ErrorSink &errors) {
+  AJsonValidator *own = validator.clone();
+  bool valid = own->validate(&v, path.str());
+  const AJsonValidator::ValidationErr &found = own->getErrors();
+  size_t room = errors.full() ? 0 : errors.limit - errors.list.size();
+  errors.list.insert(errors.list.end(), found.begin(),
+                     found.begin() + std::min(room, found.size()));
+  delete own;
+  return valid;
+}
+
+bool AJsonValidator::validateAt(const AJsonValue &v, const SchemaPath &path,
+                                ErrorSink &errors) const {
+  return validate_clone(*this, v, path, errors);
+}
+
+bool AJsonValidator::validateAt(const JsonValue &v, const SchemaPath &path,
+                                ErrorSink &errors) const {
+  return validate_clone(*this, v, path, errors);
+}
+
+// Gives the subclasses access to validateAt() on their children.
+template <typename Node>
+bool AJsonValidator::runChild(const AJsonValidator &child, const Node &v,
+                              const SchemaPath &path,
+                              ErrorSink &errors) const {
+  return child.validateAt(v, path, errors);
+}
+
 TypeValidator::TypeValidator(json_type exceptedType) {
   exceptedType_ = exceptedType;
 }
 
 bool TypeValidator::validate(const AJsonValue *v, const std::string &path) {
-  if (v->getType() == exceptedType_)
+  return AJsonValidator::validate(v, errors_, path);
+}
+
+bool TypeValidator::validate(const JsonValue *v, const std::string &path) {
+  return AJsonValidator::validate(v, errors_, path);
+}
+
+bool TypeValidator::validateAt(const AJsonValue &v, const SchemaPath &path,
+                               ErrorSink &errors) const {
+  return validateNode(v, path, errors);
+}
+
+bool TypeValidator::validateAt(const JsonValue &v, const SchemaPath &path,
+                               ErrorSink &errors) const {
+  return validateNode(v, path, errors);
+}
+
+template <typename Node>
+bool TypeValidator::validateNode(const Node &v, const SchemaPath &path,
+                                 ErrorSink &errors) const {
+  if (v.getType() == exceptedType_)
     return true;
   std::string msg;
   msg = "Excepted: " + match_json_name(exceptedType_);
-  msg += ", got: " + match_json_name(v->getType());
-  addError(path, msg);
+  msg += ", got: " + match_json_name(v.getType());
+  errors.add(path, msg);
   return false;
 }
 
@@ -128,11 +286,11 @@ ObjectValidator &ObjectValidator::property(const std::string &name,
                                            const AJsonValidator &v) {
   if (matchMode_)
     return *this;
-  if (properties_[name]) {
-    delete properties_[name];
-  }
-  properties_[name] = v.clone();
-  last_ = properties_[name];
+  AJsonValidator *&slot = properties_[JsonKey(name)];
+  if (slot)
+    delete slot;
+  slot = v.clone();
+  last_ = slot;
   return *this;
 }
 
@@ -155,65 +313,81 @@ ObjectValidator &ObjectValidator::notEmpty() {
 }
 
 bool ObjectValidator::validate(const AJsonValue *v, const std::string &path) {
+  return AJsonValidator::validate(v, errors_, path);
+}
+
+bool ObjectValidator::validate(const JsonValue *v, const std::string &path) {
+  return AJsonValidator::validate(v, errors_, path);
+}
+
+bool ObjectValidator::validateAt(const AJsonValue &v, const SchemaPath &path,
+                                 ErrorSink &errors) const {
+  return validateNode(v, path, errors);
+}
+
+bool ObjectValidator::validateAt(const JsonValue &v, const SchemaPath &path,
+                                 ErrorSink &errors) const {
+  return validateNode(v, path, errors);
+}
+
+template <typename Node>
+bool ObjectValidator::validateNode(const Node &v, const SchemaPath &path,
+                                   ErrorSink &errors) const {
   TypeValidator typeCheck(OBJECT);
-  if (!typeCheck.validate(v, path)) {
-    errors_ = typeCheck.getErrors();
+  if (!runChild(typeCheck, v, path, errors))
     return false;
-  }
-  applyDefaults(const_cast<AJsonValue *>(v));
-  JsonObject *obj = (v)->asObject();
   bool valid = true;
-  if (emptyCheck && obj->size() < 1) {
-    addError(path, "Object must not be empty!");
+  if (emptyCheck && node_size(v) < 1) {
+    errors.add(path, "Object must not be empty!");
     return false;
   }
   if (matchMode_) {
-    JsonObject::const_iterator it = obj->begin();
-    for (; it != obj->end(); it++) {
-      const JsonString string = JsonString(it->first);
-      std::string propPath =
-          (path.empty() ? it->first : path + ".<" + it->first) + '>';
-      if (!key_validator->validate(&string, propPath)) {
-        AJsonValidator::ValidationErr keyErr = key_validator->getErrors();
-        errors_.insert(errors_.end(), keyErr.begin(), keyErr.end());
-        key_validator->clearErrors();
+    for (MemberCursor<Node> it(v); !it.done(); it.next()) {
+      const JsonString key(it.keyData(), it.keyLength());
+      SchemaPath member =
+          path.child(SchemaPath::MATCH, it.keyData(), it.keyLength());
+      if (!runChild<AJsonValue>(*key_validator, key, member, errors)) {
         valid = false;
+        if (errors.full())
+          return false;
       }
-      if (!val_validator->validate(it->second, propPath)) {
-        AJsonValidator::ValidationErr valErr = val_validator->getErrors();
-        errors_.insert(errors_.end(), valErr.begin(), valErr.end());
-        val_validator->clearErrors();
+      if (!runChild(*val_validator, it.value(), member, errors)) {
         valid = false;
+        if (errors.full())
+          return false;
       }
     }
     return valid;
   }
   ValidatorMap::const_iterator it = properties_.begin();
   for (; it != properties_.end(); it++) {
-    std::string propPath = (path.empty() ? it->first : path + "." + it->first);
-    AJsonValue &propValue = (*v)[it->first];
-    if (!propValue) {
-      if (it->second->get_optional())
+    SchemaPath member =
+        path.child(SchemaPath::PROPERTY, it->first.data(), it->first.size());
+    const Node *propValue = find_member(v, it->first);
+    if (!propValue || propValue->isNull()) {
+      if (it->second->get_optional() || it->second->has_default())
         continue;
-      addError(propPath, "Missing Field!");
+      errors.add(member, "Missing Field!");
       valid = false;
+      if (errors.full())
+        return false;
       continue;
     }
-    if (!it->second->validate(&propValue, propPath)) {
-      AJsonValidator::ValidationErr propsErrs = it->second->getErrors();
-      errors_.insert(errors_.end(), propsErrs.begin(), propsErrs.end());
-      it->second->clearErrors();
+    if (!runChild(*it->second, *propValue, member, errors)) {
       valid = false;
+      if (errors.full())
+        return false;
     }
   }
   if (!allowAdditional_) {
-    JsonObject::const_iterator o_it = obj->begin();
-    for (; o_it != obj->end(); o_it++) {
-      if (properties_.find(o_it->first) == properties_.end()) {
-        std::string propPath =
-            (path.empty() ? o_it->first : path + "." + o_it->first);
-        addError(propPath, "Unexpected property");
+    for (MemberCursor<Node> o_it(v); !o_it.done(); o_it.next()) {
+      if (properties_.find(o_it.handle()) == properties_.end()) {
+        SchemaPath member = path.child(SchemaPath::PROPERTY, o_it.keyData(),
+                                       o_it.keyLength());
+        errors.add(member, "Unexpected property");
         valid = false;
+        if (errors.full())
+          return false;
       }
     }
   }
@@ -236,15 +410,20 @@ AJsonValue *ObjectValidator::applyDefaults(AJsonValue *v) {
   }
 
   JsonObject *obj = v->asObject();
+  if (matchMode_) {
+    for (JsonObject::iterator it = obj->begin(); it != obj->end(); ++it)
+      val_validator->applyDefaults(it->second);
+    return v;
+  }
   for (ValidatorMap::iterator it = properties_.begin(); it != properties_.end();
        ++it) {
-    AJsonValue &propValue = (*obj)[it->first];
+    AJsonValue &propValue = (*obj)[it->first.str()];
     if (!propValue && it->second->has_default()) {
-      obj->setProperty(it->first, it->second->get_default());
+      obj->setProperty(it->first.str(), it->second->get_default());
     } else if (!propValue.isEmpty()) {
       AJsonValue *newValue = it->second->applyDefaults(&propValue);
       if (newValue != &propValue) {
-        obj->replaceProperty(it->first, newValue);
+        obj->replaceProperty(it->first.str(), newValue);
       }
     }
   }
@@ -299,32 +478,51 @@ ArrayValidator &ArrayValidator::max(size_t size) {
 ArrayValidator &ArrayValidator::optional() { return *this; }
 
 bool ArrayValidator::validate(const AJsonValue *v, const std::string &path) {
+  return AJsonValidator::validate(v, errors_, path);
+}
+
+bool ArrayValidator::validate(const JsonValue *v, const std::string &path) {
+  return AJsonValidator::validate(v, errors_, path);
+}
+
+bool ArrayValidator::validateAt(const AJsonValue &v, const SchemaPath &path,
+                                ErrorSink &errors) const {
+  return validateNode(v, path, errors);
+}
+
+bool ArrayValidator::validateAt(const JsonValue &v, const SchemaPath &path,
+                                ErrorSink &errors) const {
+  return validateNode(v, path, errors);
+}
+
+template <typename Node>
+bool ArrayValidator::validateNode(const Node &v, const SchemaPath &path,
+                                  ErrorSink &errors) const {
   TypeValidator checkType(ARRAY);
-  if (!checkType.validate(v, path)) {
-    errors_ = checkType.getErrors();
+  if (!runChild(checkType, v, path, errors))
     return false;
-  }
-  applyDefaults(const_cast<AJsonValue *>(v));
-  JsonArray &array = *v->asArray();
+  size_t size = node_size(v);
   bool valid = true;
 
-  if (array.size() < min_) {
-    addError("[]" + path, "Array too small (min " + to_string(min_) + ")");
+  SchemaPath bounds = path.child(SchemaPath::SIZE, NULL, 0);
+  if (size < min_) {
+    errors.add(bounds, "Array too small (min " + to_string(min_) + ")");
     valid = false;
   }
 
-  if (array.size() > max_) {
-    addError("[]" + path, "Array too large (max " + to_string(max_) + ")");
+  if (size > max_ && !errors.full()) {
+    errors.add(bounds, "Array too large (max " + to_string(max_) + ")");
     valid = false;
   }
+  if (errors.full())
+    return false;
   if (validator_) {
-    for (unsigned long i = 0; i < array.size(); i++) {
-      std::string itemPath = path + "[" + to_string(i) + "]";
-      if (!validator_->validate(&array[i], itemPath)) {
-        const ValidationErr &tmp_errors = validator_->getErrors();
-        errors_.insert(errors_.end(), tmp_errors.begin(), tmp_errors.end());
-        validator_->clearErrors();
+    for (unsigned long i = 0; i < size; i++) {
+      SchemaPath item = path.child(SchemaPath::ITEM, NULL, i);
+      if (!runChild(*validator_, node_at(v, i), item, errors)) {
         valid = false;
+        if (errors.full())
+          return false;
       }
     }
   }
@@ -387,41 +585,61 @@ ORValidator &ORValidator::addConditions(const AJsonValidator &v) {
 }
 
 bool ORValidator::validate(const AJsonValue *v, const std::string &path) {
+  return AJsonValidator::validate(v, errors_, path);
+}
+
+bool ORValidator::validate(const JsonValue *v, const std::string &path) {
+  return AJsonValidator::validate(v, errors_, path);
+}
+
+bool ORValidator::validateAt(const AJsonValue &v, const SchemaPath &path,
+                             ErrorSink &errors) const {
+  return validateNode(v, path, errors);
+}
+
+bool ORValidator::validateAt(const JsonValue &v, const SchemaPath &path,
+                             ErrorSink &errors) const {
+  return validateNode(v, path, errors);
+}
+
+template <typename Node>
+bool ORValidator::validateNode(const Node &v, const SchemaPath &path,
+                               ErrorSink &errors) const {
   if (conditions_.empty()) {
-    addError(path, "No conditions specified in ANY validator");
+    errors.add(path, "No conditions specified in ANY validator");
     return false;
   }
 
+  // Each branch may report as many errors as the OR itself, and one when the
+  // OR reports its own message instead.
+  size_t room = !msg_.empty()             ? 1
+                : errors.limit == NO_LIMIT ? NO_LIMIT
+                                           : errors.limit - errors.list.size();
   ValidationErr betterErr;
   bool anyValid = false;
 
   for (unsigned long i = 0; i < conditions_.size(); i++) {
-    AJsonValidator *validator = conditions_[i];
-    if (validator->validate(v, path))
+    const AJsonValidator *validator = conditions_[i];
+    ValidationErr errs;
+    ErrorSink branch = {errs, room};
+    if (runChild(*validator, v, path, branch))
       return true;
-    const ValidationErr &errs = validator->getErrors();
-    if (!errs.empty() && isTypeCompatible(*validator, v)) {
+    if (!errs.empty() && isTypeCompatible(*validator, &v)) {
       if (!anyValid || errs.size() < betterErr.size()) {
-        betterErr = errs;
+        betterErr.swap(errs);
         anyValid = true;
       }
     } else if (!anyValid && betterErr.empty()) {
-      betterErr = errs;
+      betterErr.swap(errs);
     }
-    validator->clearErrors();
-  }
-
-  if (!anyValid) {
-    addError(path, "Value didn't match any ANY conditions");
-  }
-
-  if (msg_.empty()) {
-    errors_ = betterErr;
-  } else {
-    errors_.clear();
-    errors_.push_back(ValidationError(path, msg_));
   }
 
+  // Without a message of its own, the OR reports the errors of its best
+  // branch: the type-compatible one with the fewest.
+  if (msg_.empty())
+    errors.list.insert(errors.list.end(), betterErr.begin(), betterErr.end());
+  else
+    errors.add(path, msg_);
   return false;
 }
 
@@ -565,33 +783,53 @@ StringValidator &StringValidator::notEmpty() {
 }
 
 bool StringValidator::validate(const AJsonValue *v, const std::string &path) {
+  return AJsonValidator::validate(v, errors_, path);
+}
+
+bool StringValidator::validate(const JsonValue *v, const std::string &path) {
+  return AJsonValidator::validate(v, errors_, path);
+}
+
+bool StringValidator::validateAt(const AJsonValue &v, const SchemaPath &path,
+                                 ErrorSink &errors) const {
+  return validateNode(v, path, errors);
+}
+
+bool StringValidator::validateAt(const JsonValue &v, const SchemaPath &path,
+                                 ErrorSink &errors) const {
+  return validateNode(v, path, errors);
+}
+
+template <typename Node>
+bool StringValidator::validateNode(const Node &v, const SchemaPath &path,
+                                   ErrorSink &errors) const {
   TypeValidator typeCheck(STRING);
-  if (!typeCheck.validate(v, path)) {
-    errors_ = typeCheck.getErrors();
+  if (!runChild(typeCheck, v, path, errors))
     return false;
-  }
-  std::string value = v->asString();
-  if (checkMin && value.length() < min_) {
-    addError(path,
-             "String must have at least (" + to_string(min_) + ") chars!");
+  size_t length = string_length(v);
+  if (checkMin && length < min_) {
+    errors.add(path,
+               "String must have at least (" + to_string(min_) + ") chars!");
     return false;
   }
-  if (checkMax && value.length() > max_) {
-    addError(path, "String must have at most (" + to_string(max_) + ") chars!");
+  if (checkMax && length > max_) {
+    errors.add(path,
+               "String must have at most (" + to_string(max_) + ") chars!");
     return false;
   }
-  const JsonString &desiredType = dynamic_cast<const JsonString &>(*v);
   if (!checkers.empty()) {
-    std::map<std::string, funcCheck>::iterator it = checkers.begin();
+    JsonString tmp;
+    const JsonString &desiredType = as_json_string(v, tmp);
+    std::map<std::string, funcCheck>::const_iterator it = checkers.begin();
     for (; it != checkers.end(); it++) {
       if (it->second.func) {
         if (!it->second.func(desiredType)) {
-          addError(path, it->second.error);
+          errors.add(path, it->second.error);
           return false;
         }
       } else if (it->second.checker) {
         if (!(*it->second.checker)(desiredType)) {
-          addError(path, it->second.error);
+          errors.add(path, it->second.error);
           return false;
         }
       }
@@ -674,24 +912,43 @@ NumberValidator &NumberValidator::optional() {
 }
 
 bool NumberValidator::validate(const AJsonValue *v, const std::string &path) {
+  return AJsonValidator::validate(v, errors_, path);
+}
+
+bool NumberValidator::validate(const JsonValue *v, const std::string &path) {
+  return AJsonValidator::validate(v, errors_, path);
+}
+
+bool NumberValidator::validateAt(const AJsonValue &v, const SchemaPath &path,
+                                 ErrorSink &errors) const {
+  return validateNode(v, path, errors);
+}
+
+bool NumberValidator::validateAt(const JsonValue &v, const SchemaPath &path,
+                                 ErrorSink &errors) const {
+  return validateNode(v, path, errors);
+}
+
+template <typename Node>
+bool NumberValidator::validateNode(const Node &v, const SchemaPath &path,
+                                   ErrorSink &errors) const {
   TypeValidator typeCheck(NUMBER);
-  if (!typeCheck.validate(v, path)) {
-    errors_ = typeCheck.getErrors();
+  if (!runChild(typeCheck, v, path, errors))
     return false;
-  }
-  if (checkMin && checkMax && (v->asNumber() < min_ || v->asNumber() > max_)) {
-    addError(path, "Number must be between (" + to_string(min_) + ") and (" +
-                       to_string(max_) + ")!");
+  long value = v.asNumber();
+  if (checkMin && checkMax && (value < min_ || value > max_)) {
+    errors.add(path, "Number must be between (" + to_string(min_) + ") and (" +
+                         to_string(max_) + ")!");
     return false;
   }
-  if (checkMin && v->asNumber() < min_) {
-    addError(path,
-             "Number must be big than or equal to (" + to_string(min_) + ")!");
+  if (checkMin && value < min_) {
+    errors.add(path, "Number must be big than or equal to (" +
+                         to_string(min_) + ")!");
     return false;
   }
-  if (checkMax && v->asNumber() > max_) {
-    addError(path,
-             "Number must be less than or equal to (" + to_string(max_) + ")!");
+  if (checkMax && value > max_) {
+    errors.add(path, "Number must be less than or equal to (" +
+                         to_string(max_) + ")!");
     return false;
   }
   return true;
@@ -722,11 +979,29 @@ BoolValidator &BoolValidator::optional() {
 }
 
 bool BoolValidator::validate(const AJsonValue *v, const std::string &path) {
+  return AJsonValidator::validate(v, errors_, path);
+}
+
+bool BoolValidator::validate(const JsonValue *v, const std::string &path) {
+  return AJsonValidator::validate(v, errors_, path);
+}
+
+bool BoolValidator::validateAt(const AJsonValue &v, const SchemaPath &path,
+                               ErrorSink &errors) const {
+  return validateNode(v, path, errors);
+}
+
+bool BoolValidator::validateAt(const JsonValue &v, const SchemaPath &path,
+                               ErrorSink &errors) const {
+  return validateNode(v, path, errors);
+}
+
+template <typename Node>
+bool BoolValidator::validateNode(const Node &v, const SchemaPath &path,
+                                 ErrorSink &errors) const {
   TypeValidator typeCheck(BOOLEAN);
-  if (!typeCheck.validate(v, path)) {
-    errors_ = typeCheck.getErrors();
+  if (!runChild(typeCheck, v, path, errors))
     return false;
-  }
   return true;
 }
 
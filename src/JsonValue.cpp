@@ -0,0 +1,457 @@
+#include "JsonValue.hpp"
+#include "Arena.hpp"
+#include "Json.hpp"
+#include "JsonTypes.hpp"
+#include "parser.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+JsonValue JsonValue::null() {
+  JsonValue v;
+  v.u.number = 0;
+  v.length = 0;
+  v.type = NIL;
+  return v;
+}
+
+json_type JsonValue::getType() const { return type; }
+bool JsonValue::isArray() const { return type == ARRAY; }
+bool JsonValue::isObject() const { return type == OBJECT; }
+bool JsonValue::isNumber() const { return type == NUMBER; }
+bool JsonValue::isString() const { return type == STRING; }
+bool JsonValue::isDouble() const { return type == DOUBLE; }
+bool JsonValue::isNull() const { return type == NIL; }
+bool JsonValue::isBool() const { return type == BOOLEAN; }
+
+bool JsonValue::asBool() const { return type == BOOLEAN ? u.boolean : false; }
+
+long JsonValue::asNumber() const { return type == NUMBER ? u.number : 0; }
+
+double JsonValue::asDouble() const { return type == DOUBLE ? u.real : 0.0; }
+
+std::string JsonValue::asString() const {
+  if (type != STRING)
+    return "";
+  return std::string(u.string, length);
+}
+
+const char *JsonValue::data() const { return type == STRING ? u.string : ""; }
+
+size_t JsonValue::size() const {
+  if (type == STRING || type == ARRAY || type == OBJECT)
+    return length;
+  return 0;
+}
+
+// Members keep the document order, duplicates included; scanning from the
+// back makes the last duplicate win like in JsonObject.
+const JsonValue *JsonValue::find(const char *key, size_t keyLength) const {
+  if (type != OBJECT)
+    return NULL;
+  for (size_t i = length; i > 0; --i) {
+    const JsonMember &m = u.members[i - 1];
+    if (m.keyLength == keyLength &&
+        (m.key == key || std::memcmp(m.key, key, keyLength) == 0))
+      return &m.value;
+  }
+  return NULL;
+}
+
+static const JsonValue &null_value() {
+  static const JsonValue null = JsonValue::null();
+  return null;
+}
+
+const JsonValue &JsonValue::operator[](const std::string &item) const {
+  const JsonValue *v = find(item.data(), item.size());
+  return v ? *v : null_value();
+}
+
+const JsonValue &JsonValue::operator[](const unsigned long &idx) const {
+  if (type != ARRAY || idx >= length)
+    return null_value();
+  return u.elements[idx];
+}
+
+const JsonValue &JsonValue::at(const std::string &item) const {
+  if (type != OBJECT)
+    throw std::runtime_error("Not an object");
+  const JsonValue *v = find(item.data(), item.size());
+  if (!v)
+    throw std::runtime_error("Key '" + item + "' not found");
+  return *v;
+}
+
+const JsonValue &JsonValue::at(const unsigned long &idx) const {
+  if (type != ARRAY)
+    throw std::runtime_error("Not an array");
+  if (idx >= length)
+    throw std::runtime_error("Index [" + to_string(idx) + "] out of range");
+  return u.elements[idx];
+}
+
+const JsonMember *JsonValue::begin() const {
+  return type == OBJECT ? u.members : NULL;
+}
+
+const JsonMember *JsonValue::end() const {
+  return type == OBJECT ? u.members + length : NULL;
+}
+
+JsonValue::operator bool_type() const {
+  return type == NIL ? 0 : &JsonValue::dummy;
+}
+
+void JsonValue::dummy() const {}
+
+static AJsonValue *scalar_tree(const JsonValue &v) {
+  switch (v.type) {
+  case BOOLEAN:
+    return new JsonBool(v.u.boolean);
+  case NUMBER:
+    return new JsonNumber(v.u.number);
+  case DOUBLE:
+    return new JsonDouble(v.u.real);
+  case STRING:
+    return new JsonString(std::string(v.u.string, v.length));
+  default:
+    return new JsonNull();
+  }
+}
+
+typedef std::vector<std::pair<const JsonValue *, AJsonValue *> > TreeList;
+
+// Containers are created empty and queued in `pending` to be filled, so
+// the conversion never recurses.
+static AJsonValue *shallow_tree(const JsonValue &v, TreeList &pending) {
+  AJsonValue *node;
+  if (v.type == OBJECT)
+    node = new JsonObject();
+  else if (v.type == ARRAY)
+    node = new JsonArray();
+  else
+    return scalar_tree(v);
+  pending.push_back(std::make_pair(&v, node));
+  return node;
+}
+
+// Deletes the nodes of duplicate members that lost to a later one, and
+// unqueues those queued since `queued`.
+static void drop_replaced(TreeList &pending, size_t queued,
+                          std::vector<AJsonValue *> &replaced) {
+  std::sort(replaced.begin(), replaced.end());
+  size_t kept = queued;
+  for (size_t i = queued; i < pending.size(); ++i)
+    if (!std::binary_search(replaced.begin(), replaced.end(),
+                            pending[i].second))
+      pending[kept++] = pending[i];
+  pending.resize(kept);
+  for (size_t i = 0; i < replaced.size(); ++i)
+    delete replaced[i];
+}
+
+AJsonValue *JsonValue::toTree() const {
+  TreeList pending;
+  AJsonValue *root = shallow_tree(*this, pending);
+  try {
+    while (!pending.empty()) {
+      const JsonValue &from = *pending.back().first;
+      AJsonValue *to = pending.back().second;
+      pending.pop_back();
+      if (from.type == ARRAY) {
+        JsonArray *array = to->asArray();
+        array->elements.reserve(from.length);
+        for (size_t i = 0; i < from.length; ++i)
+          array->elements.push_back(shallow_tree(from.u.elements[i], pending));
+      } else {
+        // Appended in order: finish() keeps the last duplicate, and the
+        // nodes it replaces are deleted before they are filled.
+        JsonObject *object = to->asObject();
+        size_t queued = pending.size();
+        for (size_t i = 0; i < from.length; ++i) {
+          const JsonMember &member = from.u.members[i];
+          object->members.append(JsonKey(member.key, member.keyLength),
+                                 shallow_tree(member.value, pending));
+        }
+        std::vector<AJsonValue *> replaced;
+        object->members.finish(replaced);
+        if (!replaced.empty())
+          drop_replaced(pending, queued, replaced);
+      }
+    }
+  } catch (...) {
+    delete root;
+    throw;
+  }
+  return root;
+}
+
+static void print_scalar(std::ostream &os, const JsonValue &v) {
+  if (v.isNull()) {
+    os << "(null)";
+  } else if (v.isString()) {
+    os << '"';
+    os.write(v.data(), v.size());
+    os << '"';
+  } else if (v.isNumber()) {
+    os << v.asNumber();
+  } else if (v.isDouble()) {
+    os << v.asDouble();
+  } else if (v.isBool()) {
+    os << (v.asBool() ? "true" : "false");
+  }
+}
+
+// A container being printed and the position of its next child.
+struct PrintFrame {
+  const JsonValue *container;
+  size_t next;
+  unsigned indent;
+};
+
+// Nested containers are kept on an explicit stack rather than recursed into.
+std::ostream &printJson(std::ostream &os, const JsonValue &v,
+                        unsigned indent) {
+  std::vector<PrintFrame> open;
+  const JsonValue *value = &v;
+
+  while (true) {
+    if (value->isObject() || value->isArray()) {
+      os << (value->isObject() ? "{\n" : "[\n");
+      PrintFrame frame = {value, 0, indent};
+      open.push_back(frame);
+    } else
+      print_scalar(os, *value);
+
+    value = NULL;
+    while (!open.empty()) {
+      PrintFrame &frame = open.back();
+      const JsonValue &container = *frame.container;
+      if (frame.next) {
+        if (frame.next < container.length)
+          os << ",";
+        os << "\n";
+      }
+      if (frame.next < container.length) {
+        os << std::string((frame.indent + 1) * 2, ' ');
+        if (container.isObject()) {
+          const JsonMember &member = container.u.members[frame.next];
+          os << '"';
+          os.write(member.key, member.keyLength);
+          os << "\": ";
+          value = &member.value;
+        } else
+          value = &container.u.elements[frame.next];
+        indent = frame.indent + 1;
+        ++frame.next;
+        break;
+      }
+      os << std::string(frame.indent * 2, ' ')
+         << (container.isObject() ? "}" : "]");
+      open.pop_back();
+    }
+    if (open.empty())
+      return os;
+  }
+}
+
+std::ostream &operator<<(std::ostream &os, const JsonValue &v) {
+  return printJson(os, v);
+}
+
+// Children of the containers being parsed are collected on two scratch
+// stacks and copied into the arena in one block once their count is known.
+// Open containers are frames on an explicit stack, bounded by maxDepth; a
+// frame inside an object also holds the key of the member being parsed.
+struct CompactFrame {
+  bool object;
+  size_t base;
+  const char *key;
+  unsigned int keyLength;
+};
+
+struct CompactContext {
+  Tokenizer tz;
+  token tk;
+  Arena &arena;
+  KeyPool *keys;
+  size_t maxDepth;
+  std::vector<CompactFrame> open;
+  std::vector<JsonValue> elements;
+  std::vector<JsonMember> members;
+
+  CompactContext(const char *begin, const char *end, Arena &arena,
+                 KeyPool *keys, size_t maxDepth)
+      : tz(begin, end), arena(arena), keys(keys), maxDepth(maxDepth) {}
+};
+
+static void malformed() { throw std::runtime_error("Malformed JSON file!"); }
+
+static void too_deep() {
+  throw std::runtime_error("Maximum nesting depth exceeded!");
+}
+
+// Lengths and child counts are stored on 32 bits.
+static unsigned int compact_length(size_t length) {
+  if (length > static_cast<unsigned int>(-1))
+    throw std::runtime_error("Value too large!");
+  return static_cast<unsigned int>(length);
+}
+
+// Reads `"key" :` into the innermost frame.
+static void read_compact_key(CompactContext &ctx) {
+  token &tk = ctx.tk;
+  CompactFrame &frame = ctx.open.back();
+  if (tk.type != TK_STRING)
+    malformed();
+  if (ctx.keys)
+    frame.key = ctx.keys->intern(tk.token.data(), tk.token.size()).data();
+  else
+    frame.key = ctx.arena.copy(tk.token.data(), tk.token.size());
+  frame.keyLength = compact_length(tk.token.size());
+  ctx.tz.next(tk);
+  if (tk.type != COLON)
+    malformed();
+  ctx.tz.next(tk);
+}
+
+static void read_compact_scalar(CompactContext &ctx, JsonValue &out) {
+  token &tk = ctx.tk;
+
+  out = JsonValue::null();
+  switch (tk.type) {
+  case TK_STRING:
+    out.type = STRING;
+    out.length = compact_length(tk.token.size());
+    out.u.string = ctx.arena.copy(tk.token.data(), tk.token.size());
+    break;
+  case TK_NUMBER:
+    out.type = NUMBER;
+    out.u.number = tk.number;
+    break;
+  case TK_DOUBLE:
+    out.type = DOUBLE;
+    out.u.real = tk.real;
+    break;
+  case TK_BOOLEAN:
+    out.type = BOOLEAN;
+    out.u.boolean = tk.token == "true";
+    break;
+  case TK_NIL:
+    break;
+  default:
+    malformed();
+  }
+}
+
+// Pops the innermost frame and moves its children into the arena.
+static void close_compact(CompactContext &ctx, JsonValue &out) {
+  CompactFrame frame = ctx.open.back();
+  ctx.open.pop_back();
+  out = JsonValue::null();
+  if (frame.object) {
+    size_t count = ctx.members.size() - frame.base;
+    out.length = compact_length(count);
+    JsonMember *members = static_cast<JsonMember *>(
+        ctx.arena.allocate(count * sizeof(JsonMember)));
+    if (count)
+      std::memcpy(members, &ctx.members[frame.base],
+                  count * sizeof(JsonMember));
+    ctx.members.resize(frame.base);
+    out.type = OBJECT;
+    out.u.members = members;
+  } else {
+    size_t count = ctx.elements.size() - frame.base;
+    out.length = compact_length(count);
+    JsonValue *elements = static_cast<JsonValue *>(
+        ctx.arena.allocate(count * sizeof(JsonValue)));
+    if (count)
+      std::memcpy(elements, &ctx.elements[frame.base],
+                  count * sizeof(JsonValue));
+    ctx.elements.resize(frame.base);
+    out.type = ARRAY;
+    out.u.elements = elements;
+  }
+}
+
+// Same grammar and token discipline as the AJsonValue builder in Json.cpp.
+static void parse_compact_value(CompactContext &ctx, JsonValue &out) {
+  token &tk = ctx.tk;
+  JsonValue value;
+
+  for (;;) {
+    if (tk.type == CB_OPEN || tk.type == SB_OPEN) {
+      if (ctx.open.size() >= ctx.maxDepth)
+        too_deep();
+      bool object = tk.type == CB_OPEN;
+      CompactFrame frame = {object,
+                            object ? ctx.members.size() : ctx.elements.size(),
+                            NULL, 0};
+      ctx.open.push_back(frame);
+      ctx.tz.next(tk);
+      if (tk.type != (object ? CB_CLOSE : SB_CLOSE)) {
+        if (object)
+          read_compact_key(ctx);
+        continue;
+      }
+      close_compact(ctx, value);
+    } else
+      read_compact_scalar(ctx, value);
+    ctx.tz.next(tk);
+
+    for (;;) {
+      if (ctx.open.empty()) {
+        out = value;
+        return;
+      }
+      CompactFrame &frame = ctx.open.back();
+      if (frame.object) {
+        JsonMember member;
+        member.key = frame.key;
+        member.keyLength = frame.keyLength;
+        member.value = value;
+        ctx.members.push_back(member);
+      } else
+        ctx.elements.push_back(value);
+      if (tk.type == COMMA) {
+        ctx.tz.next(tk);
+        if (frame.object)
+          read_compact_key(ctx);
+        else if (tk.type == SB_CLOSE)
+          malformed();
+        break;
+      }
+      if (tk.type != (frame.object ? CB_CLOSE : SB_CLOSE))
+        malformed();
+      close_compact(ctx, value);
+      ctx.tz.next(tk);
+    }
+  }
+}
+
+// With a KeyPool, member keys point into the pooled entries so a repeated
+// key is stored once. Errors are located like those of the tree parsers.
+JsonValue Json::parse_compact(const char *data, size_t length, Arena &arena,
+                              KeyPool *keys, size_t maxDepth) {
+  CompactContext ctx(data, data + length, arena, keys, maxDepth);
+  JsonValue root = JsonValue::null();
+
+  try {
+    ctx.tz.next(ctx.tk);
+    if (ctx.tk.type == END)
+      return root;
+    if (ctx.tk.type != CB_OPEN && ctx.tk.type != SB_OPEN)
+      malformed();
+    parse_compact_value(ctx, root);
+    if (ctx.tk.type != END)
+      malformed();
+  } catch (const std::runtime_error &e) {
+    throw ParseError(e.what(), data, ctx.tk.offset);
+  }
+  return root;
+}
@@ -0,0 +1,353 @@
+#include "LazyDocument.hpp"
+#include "JsonTypes.hpp"
+#include "scan.hpp"
+#include "utils.hpp"
+#include <cstring>
+#include <stdexcept>
+
+static const size_t npos = static_cast<size_t>(-1);
+
+LazyValue::LazyValue() : doc_(NULL), entry_(npos), close_(npos) {}
+
+LazyValue::LazyValue(const LazyDocument *doc, size_t entry)
+    : doc_(doc), entry_(entry), close_(npos) {}
+
+LazyValue::LazyValue(const LazyDocument *doc, size_t entry, size_t close)
+    : doc_(doc), entry_(entry), close_(close) {}
+
+json_type LazyValue::getType() const {
+  if (!doc_)
+    return NIL;
+  char c = doc_->at(entry_);
+  if (c == '{')
+    return OBJECT;
+  if (c == '[')
+    return ARRAY;
+  token tk;
+  doc_->read(entry_, tk);
+  switch (tk.type) {
+  case TK_STRING:
+    return STRING;
+  case TK_NUMBER:
+    return NUMBER;
+  case TK_DOUBLE:
+    return DOUBLE;
+  case TK_BOOLEAN:
+    return BOOLEAN;
+  case TK_NIL:
+    return NIL;
+  default:
+    doc_->malformed(entry_);
+  }
+  return UNDEFINED;
+}
+
+bool LazyValue::isObject() const { return doc_ && doc_->at(entry_) == '{'; }
+bool LazyValue::isArray() const { return doc_ && doc_->at(entry_) == '['; }
+bool LazyValue::isString() const { return getType() == STRING; }
+bool LazyValue::isNumber() const { return getType() == NUMBER; }
+bool LazyValue::isDouble() const { return getType() == DOUBLE; }
+bool LazyValue::isBool() const { return getType() == BOOLEAN; }
+bool LazyValue::isNull() const { return getType() == NIL; }
+
+size_t LazyValue::size() const {
+  size_t count = 0;
+  if (isObject()) {
+    size_t close = doc_->match_[entry_];
+    for (size_t i = doc_->first(entry_); i != npos;
+         i = doc_->next(i + 2, close))
+      ++count;
+  } else if (isArray()) {
+    size_t close = doc_->match_[entry_];
+    for (size_t i = doc_->first(entry_); i != npos; i = doc_->next(i, close))
+      ++count;
+  }
+  return count;
+}
+
+// Walks every member: like the parser, the last of duplicate keys wins.
+LazyValue LazyValue::operator[](const std::string &key) const {
+  if (!isObject())
+    return LazyValue();
+  size_t close = doc_->match_[entry_];
+  size_t found = npos;
+  for (size_t i = doc_->first(entry_); i != npos;
+       i = doc_->next(i + 2, close)) {
+    if (doc_->at(i) != '"' || doc_->at(i + 1) != ':' || i + 2 >= close)
+      doc_->malformed(i);
+    if (doc_->keyEquals(i, key))
+      found = i + 2;
+  }
+  return found == npos ? LazyValue() : LazyValue(doc_, found, close);
+}
+
+LazyValue LazyValue::operator[](const unsigned long &idx) const {
+  if (!isArray())
+    return LazyValue();
+  size_t close = doc_->match_[entry_];
+  size_t n = 0;
+  for (size_t i = doc_->first(entry_); i != npos; i = doc_->next(i, close))
+    if (n++ == idx)
+      return LazyValue(doc_, i, close);
+  return LazyValue();
+}
+
+// The item at `entry` of the container closing at `close`: the element
+// itself, or for a member the value after its key, once the key is checked.
+LazyValue LazyValue::item(size_t entry, size_t close) const {
+  if (entry == npos)
+    return LazyValue();
+  if (doc_->at(close) == ']')
+    return LazyValue(doc_, entry, close);
+  if (doc_->at(entry) != '"' || doc_->at(entry + 1) != ':' ||
+      entry + 2 >= close)
+    doc_->malformed(entry);
+  return LazyValue(doc_, entry + 2, close);
+}
+
+LazyValue LazyValue::first() const {
+  if (!isObject() && !isArray())
+    return LazyValue();
+  return item(doc_->first(entry_), doc_->match_[entry_]);
+}
+
+LazyValue LazyValue::next() const {
+  if (!doc_ || close_ == npos)
+    return LazyValue();
+  return item(doc_->next(entry_, close_), close_);
+}
+
+// A member value follows the ':' of its key; other values have no key.
+std::string LazyValue::key() const {
+  if (!doc_ || close_ == npos || doc_->at(close_) != '}')
+    return "";
+  token tk;
+  doc_->read(entry_ - 2, tk);
+  return tk.token;
+}
+
+LazyValue LazyValue::at(const std::string &key) const {
+  if (!isObject())
+    throw std::runtime_error("Not an object");
+  LazyValue value = (*this)[key];
+  if (!value)
+    throw std::runtime_error("Key '" + key + "' not found");
+  return value;
+}
+
+LazyValue LazyValue::at(const unsigned long &idx) const {
+  if (!isArray())
+    throw std::runtime_error("Not an array");
+  LazyValue value = (*this)[idx];
+  if (!value)
+    throw std::runtime_error("Index [" + to_string(idx) + "] out of range");
+  return value;
+}
+
+std::string LazyValue::asString() const {
+  if (!doc_ || doc_->at(entry_) != '"')
+    return "";
+  token tk;
+  doc_->read(entry_, tk);
+  if (tk.type != TK_STRING)
+    doc_->malformed(entry_);
+  return tk.token;
+}
+
+long LazyValue::asNumber() const {
+  if (!doc_)
+    return 0;
+  token tk;
+  doc_->read(entry_, tk);
+  return tk.type == TK_NUMBER ? tk.number : 0;
+}
+
+double LazyValue::asDouble() const {
+  if (!doc_)
+    return 0.0;
+  token tk;
+  doc_->read(entry_, tk);
+  return tk.type == TK_DOUBLE ? tk.real : 0.0;
+}
+
+bool LazyValue::asBool() const {
+  if (!doc_)
+    return false;
+  token tk;
+  doc_->read(entry_, tk);
+  return tk.type == TK_BOOLEAN && tk.token == "true";
+}
+
+AJsonValue *LazyValue::get() const {
+  return doc_ ? doc_->build(entry_) : NULL;
+}
+
+LazyValue::operator bool_type() const {
+  return doc_ ? &LazyValue::dummy : 0;
+}
+
+void LazyValue::dummy() const {}
+
+LazyDocument::LazyDocument() : begin_(NULL), end_(NULL), file_(NULL) {}
+
+LazyDocument::~LazyDocument() { clear(); }
+
+void LazyDocument::clear() {
+  for (std::map<size_t, AJsonValue *>::iterator it = built_.begin();
+       it != built_.end(); ++it)
+    AJsonValue::release(it->second);
+  built_.clear();
+  nodes_.clear();
+  index_.clear();
+  match_.clear();
+  buffer_.clear();
+  delete file_;
+  file_ = NULL;
+  begin_ = end_ = NULL;
+}
+
+// A malformed input leaves the document cleared.
+void LazyDocument::index(const char *data, size_t length) {
+  begin_ = data;
+  end_ = data + length;
+  try {
+    pair(data, length);
+  } catch (...) {
+    clear();
+    throw;
+  }
+}
+
+// Indexes the input and pairs every bracket with its closing one; this is
+// the only pass over the whole document.
+void LazyDocument::pair(const char *data, size_t length) {
+  index_.build(data, data + length);
+  match_.assign(index_.size(), 0);
+  if (!index_.size() || !at(0))
+    return;
+  if (at(0) != '{' && at(0) != '[')
+    malformed(0);
+
+  std::vector<unsigned int> open;
+  size_t i = 0;
+  for (; i < index_.size(); ++i) {
+    char c = at(i);
+    if (c == '{' || c == '[') {
+      if (open.size() >= options_.maxDepth)
+        throw ParseError("Maximum nesting depth exceeded!", begin_,
+                         index_[i]);
+      open.push_back(i);
+    }
+    else if (c == '}' || c == ']') {
+      if (open.empty() || at(open.back()) != (c == '}' ? '{' : '['))
+        malformed(i);
+      match_[open.back()] = i;
+      open.pop_back();
+      if (open.empty()) {
+        if (i + 1 < index_.size() && at(i + 1))
+          malformed(i + 1);
+        return;
+      }
+    } else if (!c)
+      break;
+  }
+  malformed(i);
+}
+
+// Errors are located at the indexed position `entry`, or at the end of the
+// input past the last one.
+void LazyDocument::malformed(size_t entry) const {
+  size_t offset = entry < index_.size() ? index_[entry] : end_ - begin_;
+  throw ParseError("Malformed JSON file!", begin_, offset);
+}
+
+char LazyDocument::at(size_t entry) const { return begin_[index_[entry]]; }
+
+size_t LazyDocument::skip(size_t entry) const {
+  char c = at(entry);
+  return c == '{' || c == '[' ? match_[entry] + 1 : entry + 1;
+}
+
+// First member or element of the container at `entry`, npos when empty.
+size_t LazyDocument::first(size_t entry) const {
+  return entry + 1 == match_[entry] ? npos : entry + 1;
+}
+
+// Member or element following the value at `entry`, npos at `close`.
+size_t LazyDocument::next(size_t entry, size_t close) const {
+  size_t after = skip(entry);
+  if (after == close)
+    return npos;
+  if (after > close || at(after) != ',' || after + 1 == close)
+    malformed(after);
+  return after + 1;
+}
+
+// Keys without escapes are compared in place; the others are decoded.
+bool LazyDocument::keyEquals(size_t entry, const std::string &key) const {
+  const char *p = begin_ + index_[entry] + 1;
+  const char *q = find_string_special(p, end_);
+  if (q < end_ && *q == '"')
+    return static_cast<size_t>(q - p) == key.size() &&
+           std::memcmp(p, key.data(), key.size()) == 0;
+  token tk;
+  read(entry, tk);
+  if (tk.type != TK_STRING)
+    malformed(entry);
+  return tk.token == key;
+}
+
+// Tokenizes the scalar at `entry`. Only whitespace may separate it from the
+// next indexed position.
+void LazyDocument::read(size_t entry, token &tk) const {
+  Tokenizer tz(begin_, end_);
+  tz.seek(index_[entry]);
+  tz.next(tk);
+  const char *stop =
+      entry + 1 < index_.size() ? begin_ + index_[entry + 1] : end_;
+  const char *p = begin_ + tz.offset();
+  if (p != stop && skip_whitespace(p, stop) != stop)
+    malformed(entry);
+}
+
+AJsonValue *LazyDocument::build(size_t entry) const {
+  std::map<size_t, AJsonValue *>::iterator it = built_.find(entry);
+  if (it != built_.end())
+    return it->second;
+  AJsonValue *value =
+      Json::parse_indexed(begin_, end_, index_, entry, options_, &nodes_);
+  built_[entry] = value;
+  return value;
+}
+
+LazyValue LazyDocument::parse(const char *data, size_t length,
+                              const ParseOptions &options) {
+  clear();
+  options_ = options;
+  index(data, length);
+  return root();
+}
+
+LazyValue LazyDocument::parse(const std::string &raw,
+                              const ParseOptions &options) {
+  clear();
+  options_ = options;
+  buffer_ = raw;
+  index(buffer_.data(), buffer_.size());
+  return root();
+}
+
+LazyValue LazyDocument::parseFile(const std::string &filename,
+                                  const ParseOptions &options) {
+  clear();
+  options_ = options;
+  file_ = new MappedFile(filename);
+  index(file_->data(), file_->size());
+  return root();
+}
+
+LazyValue LazyDocument::root() const {
+  if (!index_.size() || !at(0))
+    return LazyValue();
+  return LazyValue(this, 0);
+}
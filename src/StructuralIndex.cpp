@@ -0,0 +1,77 @@
+#include "StructuralIndex.hpp"
+#include "scan.hpp"
+#include <cstring>
+#include <stdexcept>
+
+static const uint64_t EVEN_BITS = ~static_cast<uint64_t>(0) / 3;
+
+// Bit i set when byte i is preceded by an odd run of backslashes. `carry`
+// tells whether the first byte of the block is escaped by the previous one.
+static uint64_t find_escaped(uint64_t backslash, uint64_t &carry) {
+  if (!backslash) {
+    uint64_t escaped = carry;
+    carry = 0;
+    return escaped;
+  }
+  backslash &= ~carry;
+  uint64_t followsEscape = backslash << 1 | carry;
+  // Adding the starts of the runs beginning on odd bits carries them to
+  // their end; the runs starting on even bits are left in place.
+  uint64_t oddStarts = backslash & ~EVEN_BITS & ~followsEscape;
+  uint64_t evenRuns = oddStarts + backslash;
+  carry = evenRuns < oddStarts;
+  uint64_t invert = evenRuns << 1;
+  return (EVEN_BITS ^ invert) & followsEscape;
+}
+
+// Bit i is the xor of bits 0..i: ones from each opening quote up to, not
+// including, its closing quote.
+static uint64_t prefix_xor(uint64_t x) {
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+void StructuralIndex::build(const char *begin, const char *end) {
+  size_t length = end - begin;
+  if (length > MAX_LENGTH)
+    throw std::runtime_error("Document too large for the structural index");
+  positions_.clear();
+
+  uint64_t escapeCarry = 0;
+  uint64_t inStringCarry = 0;
+  uint64_t scalarCarry = 0;
+  char tail[64];
+  for (size_t offset = 0; offset < length; offset += 64) {
+    const char *block = begin + offset;
+    if (length - offset < 64) {
+      std::memset(tail, ' ', sizeof(tail));
+      std::memcpy(tail, block, length - offset);
+      block = tail;
+    }
+    BlockMasks masks;
+    classify_block(block, masks);
+
+    uint64_t quotes = masks.quote & ~find_escaped(masks.backslash, escapeCarry);
+    uint64_t inString = prefix_xor(quotes) ^ inStringCarry;
+    inStringCarry = static_cast<uint64_t>(0) - (inString >> 63);
+    uint64_t scalar = ~(masks.op | masks.space | quotes | inString);
+    uint64_t scalarStarts = scalar & ~(scalar << 1 | scalarCarry);
+    scalarCarry = scalar >> 63;
+    uint64_t bits = (masks.op & ~inString) | (quotes & inString) | scalarStarts;
+    if (!bits)
+      continue;
+
+    size_t base = positions_.size();
+    positions_.resize(base + __builtin_popcountll(bits));
+    unsigned int *out = &positions_[base];
+    for (; bits; bits &= bits - 1)
+      *out++ = static_cast<unsigned int>(offset + __builtin_ctzll(bits));
+  }
+}
+
+void StructuralIndex::clear() { positions_.clear(); }
@@ -1,136 +1,248 @@
 #include "parser.hpp"
+#include "scan.hpp"
 #include <cctype>
+#include <climits>
 #include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <iostream>
 #include <ostream>
 #include <stdexcept>
 #include <string>
-#include <vector>
+#include <locale.h>
+#include <new>
+#include <pthread.h>
+#include <stdint.h>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
 
-token extract_string(std::istream &in) {
-  token tk;
-  char c = 'c';
+Tokenizer::Tokenizer(const char *begin, const char *end, bool views)
+    : begin_(begin), cur_(begin), end_(end), views_(views) {}
 
-  while (1) {
-    in.get(c);
-    if (c == '"')
-      break;
-    if (in.eof())
-      return tk.type = TK_UNDEFINED, tk;
-    if (c == '\\') {
-      if (!in.get(c))
-        break;
+size_t Tokenizer::offset() const { return cur_ - begin_; }
 
-      switch (c) {
-      case '"':
-        tk.token.push_back('"');
-        break;
-      case '\\':
-        tk.token.push_back('\\');
-        break;
-      case '/':
-        tk.token.push_back('/');
-        break;
-      case 'b':
-        tk.token.push_back('\b');
-        break;
-      case 'f':
-        tk.token.push_back('\f');
-        break;
-      case 'n':
-        tk.token.push_back('\n');
-        break;
-      case 'r':
-        tk.token.push_back('\r');
-        break;
-      case 't':
-        tk.token.push_back('\t');
-        break;
-      default:
-        tk.token.push_back(c);
-        break;
-      }
-    } else
-      tk.token.push_back(c);
+void Tokenizer::seek(size_t offset) { cur_ = begin_ + offset; }
+
+static char unescape(char c) {
+  switch (c) {
+  case 'b':
+    return '\b';
+  case 'f':
+    return '\f';
+  case 'n':
+    return '\n';
+  case 'r':
+    return '\r';
+  case 't':
+    return '\t';
+  default:
+    return c;
   }
-  tk.type = TK_STRING;
-  return tk;
 }
 
-token extract_decimal(char &c, std::istream &in) {
-  token tk;
-  int dots = 0;
-
-  if (c == '-') {
-    tk.token.push_back(c);
-    in.get(c);
+// Called with cur_ just past the opening quote. Runs of plain characters are
+// found by find_string_special() and appended in one go; only escapes are
+// handled byte by byte. In view mode a string whose first special character
+// is its closing quote is not copied at all.
+void Tokenizer::extract_string(token &tk) {
+  tk.type = TK_UNDEFINED;
+  if (views_) {
+    const char *run = cur_;
+    cur_ = find_string_special(cur_, end_);
+    if (cur_ < end_ && *cur_ == '"') {
+      tk.view = run;
+      tk.viewLength = cur_++ - run;
+      tk.type = TK_STRING;
+      return;
+    }
+    tk.token.append(run, cur_ - run);
   }
-
-  while (1) {
-    if (in.eof() || dots > 1)
-      return tk.type = TK_UNDEFINED, tk;
-    if (c == '.')
-      dots++;
-    else if (!isdigit(c)) {
-      in.unget();
-      break;
+  while (cur_ < end_) {
+    const char *run = cur_;
+    cur_ = find_string_special(cur_, end_);
+    tk.token.append(run, cur_ - run);
+    if (cur_ == end_)
+      return;
+    if (*cur_++ == '"') {
+      tk.type = TK_STRING;
+      return;
     }
-    tk.token.push_back(c);
-    in.get(c);
+    if (cur_ == end_)
+      return;
+    tk.token.push_back(unescape(*cur_++));
   }
-  if (tk.token[tk.token.length() - 1] == '.')
-    return tk.type = TK_UNDEFINED, tk;
-  tk.type = !dots ? TK_NUMBER : TK_DOUBLE;
-  return tk;
 }
 
-token extract_json_types(char &c, std::istream &in) {
-  token tk;
-  tk.type = TK_UNDEFINED;
-  std::string expected;
+// Largest integer a double holds exactly, and the powers of ten it holds
+// exactly: within those bounds one multiplication or division by an exact
+// power of ten is correctly rounded (Clinger's fast path).
+static const uint64_t MAX_EXACT_MANTISSA = static_cast<uint64_t>(1) << 53;
+static const double EXACT_POWERS[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+static const int MAX_EXACT_POWER = 22;
 
-  if (c == 't')
-    expected = "true";
-  else if (c == 'f')
-    expected = "false";
-  else if (c == 'n')
-    expected = "null";
+static bool fast_double(uint64_t mantissa, int exponent, double &value) {
+  if (mantissa > MAX_EXACT_MANTISSA)
+    return false;
+  if (exponent < -MAX_EXACT_POWER)
+    return false;
+  if (exponent < 0) {
+    value = static_cast<double>(mantissa) / EXACT_POWERS[-exponent];
+    return true;
+  }
+  // A larger exponent still works if the excess fits in the mantissa.
+  for (; exponent > MAX_EXACT_POWER; --exponent) {
+    mantissa *= 10;
+    if (mantissa > MAX_EXACT_MANTISSA)
+      return false;
+  }
+  value = static_cast<double>(mantissa) * EXACT_POWERS[exponent];
+  return true;
+}
 
-  tk.token += c;
-  for (size_t i = 1; i < expected.length(); ++i) {
-    if (!in.get(c) || c != expected[i]) {
-      // Restore the read characters to the stream to not mess up the parsing
-      // for other tokens
-      for (size_t j = 0; j < tk.token.length(); j++) {
-        in.unget();
+// The "C" locale, created once, so that numbers parse the same whatever the
+// locale of the program and without touching it.
+static locale_t c_locale;
+static pthread_once_t c_locale_once = PTHREAD_ONCE_INIT;
+
+static void make_c_locale() {
+  c_locale = newlocale(LC_ALL_MASK, "C", static_cast<locale_t>(0));
+}
+
+// Correctly rounded by the C library; the text is copied so strtod_l sees a
+// terminated string.
+static double slow_double(const char *begin, const char *end) {
+  char small[64];
+  std::string large;
+  char *text = small;
+  size_t length = end - begin;
+  if (length >= sizeof(small)) {
+    large.assign(begin, end);
+    text = &large[0];
+  } else {
+    std::memcpy(small, begin, length);
+    small[length] = '\0';
+  }
+  pthread_once(&c_locale_once, make_c_locale);
+  if (!c_locale)
+    throw std::bad_alloc();
+  return strtod_l(text, NULL, c_locale);
+}
+
+// -?digits(.digits)?([eE][+-]?digits)?. Integers are accumulated while
+// scanning and saturate like strtol; up to 19 significant digits of a
+// double are kept in a 64-bit mantissa for the fast path.
+void Tokenizer::extract_decimal(token &tk) {
+  const char *start = cur_;
+  const char *p = cur_;
+  bool negative = false;
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int dropped = 0;
+
+  tk.type = TK_UNDEFINED;
+  if (*p == '-') {
+    negative = true;
+    p++;
+  }
+  const char *first = p;
+  for (; p < end_ && isdigit(static_cast<unsigned char>(*p)); ++p) {
+    if (digits < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      digits += mantissa != 0;
+    } else
+      dropped++;
+  }
+  if (p == first)
+    return;
+  int exponent = dropped;
+  bool integer = true;
+  if (p < end_ && *p == '.') {
+    integer = false;
+    first = ++p;
+    for (; p < end_ && isdigit(static_cast<unsigned char>(*p)); ++p) {
+      if (digits < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        digits += mantissa != 0;
+        exponent--;
       }
-      return tk;
     }
-    tk.token += c;
+    if (p == first)
+      return;
   }
+  if (p < end_ && (*p == 'e' || *p == 'E')) {
+    integer = false;
+    bool negativeExp = false;
+    if (++p < end_ && (*p == '+' || *p == '-'))
+      negativeExp = *p++ == '-';
+    first = p;
+    int e = 0;
+    for (; p < end_ && isdigit(static_cast<unsigned char>(*p)); ++p) {
+      if (e < 100000)
+        e = e * 10 + (*p - '0');
+    }
+    if (p == first)
+      return;
+    exponent += negativeExp ? -e : e;
+  }
+  cur_ = p;
 
-  if (expected == "true" || expected == "false")
-    tk.type = TK_BOOLEAN;
-  else if (expected == "null")
-    tk.type = TK_NIL;
-
-  return tk;
+  if (integer && !dropped) {
+    tk.type = TK_NUMBER;
+    if (mantissa <= static_cast<uint64_t>(LONG_MAX))
+      tk.number = negative ? -static_cast<long>(mantissa)
+                           : static_cast<long>(mantissa);
+    else if (negative && mantissa - 1 == static_cast<uint64_t>(LONG_MAX))
+      tk.number = LONG_MIN;
+    else
+      tk.number = negative ? LONG_MIN : LONG_MAX;
+    return;
+  }
+  if (integer) {
+    tk.type = TK_NUMBER;
+    tk.number = negative ? LONG_MIN : LONG_MAX;
+    return;
+  }
+  tk.type = TK_DOUBLE;
+  if (digits >= 19 || !fast_double(mantissa, exponent, tk.real))
+    tk.real = slow_double(start, p);
+  else if (negative)
+    tk.real = -tk.real;
 }
 
-token Tokenizer::extract_token(std::istream &in) {
-  token tk;
-  char c = 'c';
+void Tokenizer::extract_json_types(token &tk) {
+  static const char *const literals[] = {"true", "false", "null"};
+  static const t_type types[] = {TK_BOOLEAN, TK_BOOLEAN, TK_NIL};
 
   tk.type = TK_UNDEFINED;
-  while (!in.eof()) {
-    in.get(c);
-    if (!isspace(c))
-      break;
+  for (size_t i = 0; i < 3; ++i) {
+    size_t len = std::strlen(literals[i]);
+    if (static_cast<size_t>(end_ - cur_) >= len &&
+        std::memcmp(cur_, literals[i], len) == 0) {
+      tk.token.assign(cur_, len);
+      tk.type = types[i];
+      cur_ += len;
+      return;
+    }
   }
-  if (!c || in.eof())
+}
+
+// Fills `tk` in place so the caller can keep reusing one token (and the
+// capacity of its string) for the whole document.
+void Tokenizer::next(token &tk) {
+  tk.token.clear();
+  tk.type = TK_UNDEFINED;
+  tk.view = NULL;
+  cur_ = skip_whitespace(cur_, end_);
+  tk.offset = cur_ - begin_;
+  if (cur_ == end_ || !*cur_) {
     tk.type = END;
-  else if (c == '{')
+    return;
+  }
+  char c = *cur_;
+  if (c == '{')
     tk.type = CB_OPEN;
   else if (c == '}')
     tk.type = CB_CLOSE;
@@ -142,23 +254,23 @@ token Tokenizer::extract_token(std::istream &in) {
     tk.type = COLON;
   else if (c == ',')
     tk.type = COMMA;
-  else if (c == '"')
-    tk = extract_string(in);
-  else if (isdigit(c) || c == '-')
-    tk = extract_decimal(c, in);
+  if (tk.type != TK_UNDEFINED) {
+    cur_++;
+    return;
+  }
+  if (c == '"') {
+    cur_++;
+    extract_string(tk);
+  } else if (isdigit(static_cast<unsigned char>(c)) || c == '-')
+    extract_decimal(tk);
   else if (c == 'n' || c == 't' || c == 'f')
-    tk = extract_json_types(c, in);
-  return tk;
+    extract_json_types(tk);
 }
 
-void Tokenizer::parse(std::istream &in, std::vector<token> &tokens) {
-
-  while (1) {
-    token tk = extract_token(in);
-    tokens.push_back(tk);
-    if (tk.type == END)
-      break;
-  }
+token Tokenizer::extract_token() {
+  token tk;
+  next(tk);
+  return tk;
 }
 
 std::string match_token_name(token_type type) {
@@ -196,105 +308,12 @@ std::ostream &operator<<(std::ostream &os, token &tk) {
   if (tk.type == TK_STRING)
     os << match_token_name(tk.type) << "(" << tk.token << ")";
   else if (tk.type == TK_NUMBER)
-    os << match_token_name(tk.type) << "(" << tk.token << ")";
+    os << match_token_name(tk.type) << "(" << tk.number << ")";
   else if (tk.type == TK_DOUBLE)
-    os << match_token_name(tk.type) << "(" << tk.token << ")";
+    os << match_token_name(tk.type) << "(" << tk.real << ")";
   else if (tk.type == TK_BOOLEAN || tk.type == TK_NIL)
     os << match_token_name(tk.type) << "(" << tk.token << ")";
   else
     os << match_token_name(tk.type);
   return os;
 }
-bool lexer_helper(std::vector<token> &tokens, unsigned long &pos);
-bool object_lexer(std::vector<token> &tokens, unsigned long &pos);
-bool array_lexer(std::vector<token> &tokens, unsigned long &pos);
-
-bool lexer_consume(std::vector<token> &tokens, unsigned long &pos) {
-  token_type tk1 = tokens[pos + 1].type;
-  token_type tk2 = tokens[pos + 2].type;
-  if (pos + 3 > tokens.size() || tk1 != COLON)
-    return 1;
-  if (tk2 == CB_OPEN || tk2 == SB_OPEN) {
-    pos += 2;
-    if (lexer_helper(tokens, pos))
-      return 1;
-  } else if (tk2 == TK_STRING || tk2 == TK_BOOLEAN || tk2 == TK_NIL ||
-             tk2 == TK_NUMBER || tk2 == TK_DOUBLE)
-    pos += 3;
-  else
-    return 1;
-  return 0;
-}
-
-bool object_lexer(std::vector<token> &tokens, unsigned long &pos) {
-  pos++;
-  while (pos < tokens.size() && tokens[pos].type != CB_CLOSE) {
-    if (tokens[pos].type != TK_STRING)
-      return 1;
-    if (lexer_consume(tokens, pos))
-      return 1;
-    if (tokens[pos].type == COMMA && tokens[pos + 1].type != TK_STRING)
-      return 1;
-    if (tokens[pos].type == COMMA)
-      pos++;
-    else
-      break;
-  }
-  if (tokens[pos].type == CB_CLOSE)
-    pos++;
-  else
-    return 1;
-  return 0;
-}
-
-static bool is_array_element(token_type type) {
-  return type == TK_STRING || type == SB_OPEN || type == TK_NUMBER ||
-         type == TK_DOUBLE || type == CB_OPEN || type == TK_NIL ||
-         type == TK_BOOLEAN;
-}
-
-bool array_lexer(std::vector<token> &tokens, unsigned long &pos) {
-  pos++;
-  while (pos < tokens.size() && tokens[pos].type != SB_CLOSE) {
-    if (tokens[pos].type == CB_OPEN && object_lexer(tokens, pos))
-      return 1;
-    else if (tokens[pos].type == SB_OPEN && array_lexer(tokens, pos))
-      return 1;
-    else if (is_array_element(tokens[pos].type))
-      pos++;
-    if (tokens[pos].type == COMMA && !is_array_element(tokens[pos + 1].type))
-      return 1;
-    if (tokens[pos].type == COMMA)
-      pos++;
-    else
-      break;
-  }
-  if (tokens[pos].type == SB_CLOSE)
-    pos++;
-  else
-    return 1;
-  return 0;
-}
-
-bool lexer_helper(std::vector<token> &tokens, unsigned long &pos) {
-  if (tokens[pos].type == CB_OPEN) {
-    if (object_lexer(tokens, pos))
-      return 1;
-  } else if (tokens[pos].type == SB_OPEN) {
-    if (array_lexer(tokens, pos))
-      return 1;
-  } else {
-    return 1;
-  }
-  return 0;
-}
-
-std::vector<token> &Lexer::parse(std::vector<token> &tokens) {
-  unsigned long pos = 0;
-  while (pos < tokens.size() && tokens[pos].type != END) {
-    if (lexer_helper(tokens, pos)) {
-      throw std::runtime_error("Malformed JSON file!");
-    }
-  }
-  return tokens;
-}
@@ -0,0 +1,289 @@
+#include "scan.hpp"
+#include <pthread.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+typedef const char *(*scan_fn)(const char *, const char *);
+
+// Same set as isspace() in the C locale: ' ' and '\t' through '\r'.
+static bool is_space(unsigned char c) {
+  return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+}
+
+static const char *skip_whitespace_scalar(const char *p, const char *end) {
+  while (p < end && is_space(*p))
+    p++;
+  return p;
+}
+
+static const char *find_string_special_scalar(const char *p,
+                                              const char *end) {
+  while (p < end && *p != '"' && *p != '\\')
+    p++;
+  return p;
+}
+
+#ifndef __SSE2__
+static bool is_op(char c) {
+  return c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',';
+}
+
+static void classify_block_scalar(const char *block, BlockMasks &masks) {
+  masks.quote = masks.backslash = masks.space = masks.op = 0;
+  for (unsigned i = 0; i < 64; ++i) {
+    uint64_t bit = static_cast<uint64_t>(1) << i;
+    char c = block[i];
+    if (c == '"')
+      masks.quote |= bit;
+    else if (c == '\\')
+      masks.backslash |= bit;
+    else if (is_space(c))
+      masks.space |= bit;
+    else if (is_op(c))
+      masks.op |= bit;
+  }
+}
+#endif
+
+#ifdef __SSE2__
+// A byte is whitespace if it equals ' ' or if (byte - '\t') <= 4 unsigned,
+// which min_epu8 tests without a signed compare.
+static const char *skip_whitespace_sse2(const char *p, const char *end) {
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i range = _mm_set1_epi8('\r' - '\t');
+  while (end - p >= 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i ctl = _mm_sub_epi8(x, tab);
+    __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(x, space),
+                              _mm_cmpeq_epi8(_mm_min_epu8(ctl, range), ctl));
+    unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(ws)) & 0xffff;
+    if (mask)
+      return p + __builtin_ctz(mask);
+    p += 16;
+  }
+  return skip_whitespace_scalar(p, end);
+}
+
+static const char *find_string_special_sse2(const char *p, const char *end) {
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  while (end - p >= 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    unsigned mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, backslash)));
+    if (mask)
+      return p + __builtin_ctz(mask);
+    p += 16;
+  }
+  return find_string_special_scalar(p, end);
+}
+
+static void classify_block_sse2(const char *block, BlockMasks &masks) {
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i range = _mm_set1_epi8('\r' - '\t');
+  masks.quote = masks.backslash = masks.space = masks.op = 0;
+  for (unsigned i = 0; i < 64; i += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i));
+    __m128i ctl = _mm_sub_epi8(x, tab);
+    __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(x, space),
+                              _mm_cmpeq_epi8(_mm_min_epu8(ctl, range), ctl));
+    __m128i op = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('{')),
+                     _mm_cmpeq_epi8(x, _mm_set1_epi8('}'))),
+        _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('[')),
+                         _mm_cmpeq_epi8(x, _mm_set1_epi8(']'))),
+            _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(':')),
+                         _mm_cmpeq_epi8(x, _mm_set1_epi8(',')))));
+    masks.quote |= static_cast<uint64_t>(static_cast<unsigned>(
+                       _mm_movemask_epi8(_mm_cmpeq_epi8(x, quote))))
+                   << i;
+    masks.backslash |= static_cast<uint64_t>(static_cast<unsigned>(
+                           _mm_movemask_epi8(_mm_cmpeq_epi8(x, backslash))))
+                       << i;
+    masks.space |=
+        static_cast<uint64_t>(static_cast<unsigned>(_mm_movemask_epi8(ws)))
+        << i;
+    masks.op |=
+        static_cast<uint64_t>(static_cast<unsigned>(_mm_movemask_epi8(op)))
+        << i;
+  }
+}
+#endif
+
+#ifdef SCAN_X86
+__attribute__((target("avx2"))) static const char *
+skip_whitespace_avx2(const char *p, const char *end) {
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i range = _mm256_set1_epi8('\r' - '\t');
+  while (end - p >= 32) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    __m256i ctl = _mm256_sub_epi8(x, tab);
+    __m256i ws =
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, space),
+                        _mm256_cmpeq_epi8(_mm256_min_epu8(ctl, range), ctl));
+    unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(ws));
+    if (mask)
+      return p + __builtin_ctz(mask);
+    p += 32;
+  }
+  return skip_whitespace_scalar(p, end);
+}
+
+__attribute__((target("avx2"))) static const char *
+find_string_special_avx2(const char *p, const char *end) {
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  while (end - p >= 32) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(
+        _mm256_cmpeq_epi8(x, quote), _mm256_cmpeq_epi8(x, backslash)));
+    if (mask)
+      return p + __builtin_ctz(mask);
+    p += 32;
+  }
+  return find_string_special_scalar(p, end);
+}
+
+__attribute__((target("avx2"))) static void
+classify_block_avx2(const char *block, BlockMasks &masks) {
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i range = _mm256_set1_epi8('\r' - '\t');
+  masks.quote = masks.backslash = masks.space = masks.op = 0;
+  for (unsigned i = 0; i < 64; i += 32) {
+    __m256i x =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + i));
+    __m256i ctl = _mm256_sub_epi8(x, tab);
+    __m256i ws =
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, space),
+                        _mm256_cmpeq_epi8(_mm256_min_epu8(ctl, range), ctl));
+    __m256i op = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('{')),
+                        _mm256_cmpeq_epi8(x, _mm256_set1_epi8('}'))),
+        _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('[')),
+                            _mm256_cmpeq_epi8(x, _mm256_set1_epi8(']'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(':')),
+                            _mm256_cmpeq_epi8(x, _mm256_set1_epi8(',')))));
+    masks.quote |= static_cast<uint64_t>(static_cast<unsigned>(
+                       _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, quote))))
+                   << i;
+    masks.backslash |=
+        static_cast<uint64_t>(static_cast<unsigned>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, backslash))))
+        << i;
+    masks.space |=
+        static_cast<uint64_t>(static_cast<unsigned>(_mm256_movemask_epi8(ws)))
+        << i;
+    masks.op |=
+        static_cast<uint64_t>(static_cast<unsigned>(_mm256_movemask_epi8(op)))
+        << i;
+  }
+}
+
+static bool has_avx2() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+#endif
+
+static scan_fn pick_whitespace() {
+#ifdef SCAN_X86
+  if (has_avx2())
+    return skip_whitespace_avx2;
+#endif
+#ifdef __SSE2__
+  return skip_whitespace_sse2;
+#else
+  return skip_whitespace_scalar;
+#endif
+}
+
+static scan_fn pick_string_special() {
+#ifdef SCAN_X86
+  if (has_avx2())
+    return find_string_special_avx2;
+#endif
+#ifdef __SSE2__
+  return find_string_special_sse2;
+#else
+  return find_string_special_scalar;
+#endif
+}
+
+typedef void (*classify_fn)(const char *, BlockMasks &);
+
+static classify_fn pick_classify() {
+#ifdef SCAN_X86
+  if (has_avx2())
+    return classify_block_avx2;
+#endif
+#ifdef __SSE2__
+  return classify_block_sse2;
+#else
+  return classify_block_scalar;
+#endif
+}
+
+// Each kernel pointer starts at a resolver. The first call from any thread
+// picks all three kernels once, under pthread_once, and the pointers are
+// read and written atomically so worker threads never race on them.
+static const char *resolve_whitespace(const char *p, const char *end);
+static const char *resolve_string_special(const char *p, const char *end);
+static void resolve_classify(const char *block, BlockMasks &masks);
+
+static scan_fn whitespace_kernel = resolve_whitespace;
+static scan_fn string_special_kernel = resolve_string_special;
+static classify_fn classify_kernel = resolve_classify;
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+
+static void pick_kernels() {
+  __atomic_store_n(&whitespace_kernel, pick_whitespace(), __ATOMIC_RELAXED);
+  __atomic_store_n(&string_special_kernel, pick_string_special(),
+                   __ATOMIC_RELAXED);
+  __atomic_store_n(&classify_kernel, pick_classify(), __ATOMIC_RELAXED);
+}
+
+static void resolve_classify(const char *block, BlockMasks &masks) {
+  pthread_once(&kernels_once, pick_kernels);
+  __atomic_load_n(&classify_kernel, __ATOMIC_RELAXED)(block, masks);
+}
+
+static const char *resolve_whitespace(const char *p, const char *end) {
+  pthread_once(&kernels_once, pick_kernels);
+  return __atomic_load_n(&whitespace_kernel, __ATOMIC_RELAXED)(p, end);
+}
+
+static const char *resolve_string_special(const char *p, const char *end) {
+  pthread_once(&kernels_once, pick_kernels);
+  return __atomic_load_n(&string_special_kernel, __ATOMIC_RELAXED)(p, end);
+}
+
+// Between tokens there is usually no whitespace or a single byte of it, so
+// the first bytes are checked before paying for the indirect call.
+const char *skip_whitespace(const char *p, const char *end) {
+  if (p == end || !is_space(*p))
+    return p;
+  if (++p == end || !is_space(*p))
+    return p;
+  return __atomic_load_n(&whitespace_kernel, __ATOMIC_RELAXED)(p, end);
+}
+
+const char *find_string_special(const char *p, const char *end) {
+  return __atomic_load_n(&string_special_kernel, __ATOMIC_RELAXED)(p, end);
+}
+
+void classify_block(const char *block, BlockMasks &masks) {
+  __atomic_load_n(&classify_kernel, __ATOMIC_RELAXED)(block, masks);
+}
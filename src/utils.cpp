@@ -1,8 +1,13 @@
 #include "utils.hpp"
+#include <cerrno>
 #include <cstring>
 #include <dirent.h>
+#include <fcntl.h>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <sys/mman.h>
+#include <time.h>
 #include <unistd.h>
 
 void split(std::vector<std::string> &buff, const std::string &s, char deli) {
@@ -80,3 +85,70 @@ bool FileInfo::remove_directory(const std::string &path) {
   closedir(dir);
   return rmdir(path.c_str()) == 0;
 }
+
+MappedFile::MappedFile(const std::string &path)
+    : data_(NULL), size_(0), mapped_(false) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("Could not open file: " + path);
+  struct stat st;
+  bool regular = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+  if (regular && st.st_size > 0) {
+    void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      madvise(addr, st.st_size, MADV_SEQUENTIAL);
+      data_ = static_cast<const char *>(addr);
+      size_ = st.st_size;
+      mapped_ = true;
+    }
+  }
+  if (!mapped_) {
+    try {
+      readAll(fd, regular ? st.st_size : 0);
+    } catch (...) {
+      close(fd);
+      throw;
+    }
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+  }
+  close(fd);
+}
+
+// One read() covers a regular file; the spare byte lets the loop observe EOF
+// without growing the buffer. Pipes and other streams grow it geometrically.
+void MappedFile::readAll(int fd, size_t sizeHint) {
+  size_t len = 0;
+
+  buffer_.resize(sizeHint + 1 < 4096 ? 4096 : sizeHint + 1);
+  while (1) {
+    if (len == buffer_.size())
+      buffer_.resize(buffer_.size() * 2);
+    ssize_t n = read(fd, &buffer_[len], buffer_.size() - len);
+    if (n == 0)
+      break;
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      throw std::runtime_error("Could not read file");
+    len += n;
+  }
+  buffer_.resize(len);
+}
+
+MappedFile::~MappedFile() {
+  if (mapped_)
+    munmap(const_cast<char *>(data_), size_);
+}
+
+const char *MappedFile::data() const { return data_; }
+
+size_t MappedFile::size() const { return size_; }
+
+bool MappedFile::isMapped() const { return mapped_; }
+
+double monotonic_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
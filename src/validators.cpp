@@ -2,8 +2,17 @@
 #include "utils.hpp"
 #include <string>
 
+// The text of `v`, copied into `buffer` only when it is a view.
+static const std::string &text(const JsonString &v, std::string &buffer) {
+  if (!v.isView())
+    return v.value;
+  buffer.assign(v.data(), v.size());
+  return buffer;
+}
+
 bool isEmpty_(const JsonString &v) {
-  const std::string &value = v.value;
+  std::string buffer;
+  const std::string &value = text(v, buffer);
   if (value.empty())
     return false;
   if (value.find_first_not_of(" \t\v\n\f\r") == std::string::npos)
@@ -12,7 +21,8 @@ bool isEmpty_(const JsonString &v) {
 }
 
 bool isDigit_(const JsonString &v) {
-  const std::string &value = v.value;
+  std::string buffer;
+  const std::string &value = text(v, buffer);
   if (value.empty())
     return false;
   if (value.find_first_not_of("0123456789") != std::string::npos)
@@ -21,7 +31,8 @@ bool isDigit_(const JsonString &v) {
 }
 
 bool isPort_(const JsonString &v) {
-  const std::string &value = v.value;
+  std::string buffer;
+  const std::string &value = text(v, buffer);
   if (!isDigit_(v))
     return false;
   int port = atoi(value.c_str());
@@ -31,7 +42,8 @@ bool isPort_(const JsonString &v) {
 }
 
 bool isIpv4_(const JsonString &v) {
-  const std::string &value = v.value;
+  std::string buffer;
+  const std::string &value = text(v, buffer);
   if (value.empty() || value.length() > 15)
     return false;
   if (value.find_first_not_of("0123456789.") != std::string::npos)
@@ -49,7 +61,8 @@ bool isIpv4_(const JsonString &v) {
 }
 
 bool isValidPath_(const JsonString &v) {
-  const std::string &value = v.value;
+  std::string buffer;
+  const std::string &value = text(v, buffer);
   if (value.empty())
     return false;
   FileInfo file(value);
@@ -59,7 +72,8 @@ bool isValidPath_(const JsonString &v) {
 }
 
 bool isValidDir_(const JsonString &v) {
-  const std::string &value = v.value;
+  std::string buffer;
+  const std::string &value = text(v, buffer);
   if (value.empty())
     return false;
   FileInfo file(value);
@@ -69,7 +83,8 @@ bool isValidDir_(const JsonString &v) {
 }
 
 bool isValidFile_(const JsonString &v) {
-  const std::string &value = v.value;
+  std::string buffer;
+  const std::string &value = text(v, buffer);
   if (value.empty())
     return false;
   FileInfo file(value);
@@ -0,0 +1,155 @@
+#include "Arena.hpp"
+#include "Json.hpp"
+#include "JsonDocument.hpp"
+#include "JsonParser.hpp"
+#include "test.hpp"
+#include "utils.hpp"
+#include <cstring>
+#include <string>
+
+// Arena hands out aligned memory from chunks; reset() keeps the most recent
+// chunk and rewind() sets every chunk aside for the next allocations, so
+// mallocs() only grows for memory the arena never had. A JsonDocument
+// builds its nodes there, and stops allocating chunks once reused for
+// documents no larger than the ones it has seen.
+
+static bool aligned(const void *ptr) {
+  return reinterpret_cast<size_t>(ptr) % Arena::ALIGNMENT == 0;
+}
+
+static void test_allocate() {
+  Arena arena(1024);
+  CHECK(arena.chunks() == 0 && arena.mallocs() == 0 && arena.used() == 0);
+
+  char *a = static_cast<char *>(arena.allocate(1));
+  char *b = static_cast<char *>(arena.allocate(3));
+  CHECK(aligned(a) && aligned(b) && b == a + Arena::ALIGNMENT);
+  CHECK(arena.used() == 2 * Arena::ALIGNMENT);
+  CHECK(arena.chunks() == 1 && arena.mallocs() == 1);
+
+  char *text = arena.copy("arena", 5);
+  CHECK(std::strcmp(text, "arena") == 0 && aligned(text));
+  CHECK(arena.copy("", 0)[0] == '\0');
+
+  // Past the end of the chunk, and larger than a chunk.
+  for (size_t i = 0; i < 100; ++i)
+    CHECK(aligned(arena.allocate(24)));
+  CHECK(arena.chunks() > 1 && arena.mallocs() == arena.chunks());
+  char *large = static_cast<char *>(arena.allocate(5000));
+  CHECK(aligned(large));
+  std::memset(large, 'x', 5000);
+  CHECK(arena.mallocs() == arena.chunks());
+}
+
+static void test_rewind() {
+  Arena arena(1024);
+  arena.rewind();
+  CHECK(arena.chunks() == 0 && arena.mallocs() == 0);
+
+  for (size_t i = 0; i < 200; ++i)
+    arena.allocate(i % 7 ? 40 : 3000);
+  size_t chunks = arena.chunks();
+  size_t used = arena.used();
+  CHECK(chunks == arena.mallocs() && chunks > 2);
+
+  // The same allocations again take back the chunks set aside.
+  for (size_t round = 0; round < 3; ++round) {
+    arena.rewind();
+    CHECK(arena.chunks() == 0 && arena.used() == 0);
+    for (size_t i = 0; i < 200; ++i)
+      CHECK(aligned(arena.allocate(i % 7 ? 40 : 3000)));
+    CHECK(arena.used() == used && arena.mallocs() == chunks);
+  }
+
+  // Smaller ones need no more than that.
+  arena.rewind();
+  for (size_t i = 0; i < 200; ++i)
+    arena.allocate(16);
+  CHECK(arena.mallocs() == chunks);
+}
+
+static void test_reset() {
+  Arena arena(1024);
+  arena.reset();
+  CHECK(arena.chunks() == 0 && arena.mallocs() == 0);
+
+  for (size_t i = 0; i < 100; ++i)
+    arena.allocate(64);
+  size_t mallocs = arena.mallocs();
+  CHECK(arena.chunks() > 1);
+  arena.reset();
+  CHECK(arena.chunks() == 1 && arena.used() == 0);
+
+  // The kept chunk serves what fits in it; the others are gone.
+  for (size_t i = 0; i < 10; ++i)
+    arena.allocate(64);
+  CHECK(arena.mallocs() == mallocs && arena.chunks() == 1);
+  arena.allocate(2048);
+  CHECK(arena.mallocs() == mallocs + 1 && arena.chunks() == 2);
+
+  // A reset drops the chunks a rewind set aside.
+  arena.rewind();
+  arena.reset();
+  arena.allocate(64);
+  CHECK(arena.mallocs() == mallocs + 2 && arena.chunks() == 1);
+}
+
+static std::string document(size_t count) {
+  std::string s = "[";
+  for (size_t i = 0; i < count; ++i)
+    s += (i ? ", {\"id\": " : "{\"id\": ") + to_string(i) +
+         ", \"name\": \"item\"}";
+  return s + "]";
+}
+
+static void test_document() {
+  std::string small = document(10), large = document(5000);
+  ParseStats stats;
+  ParseOptions options;
+  options.stats = &stats;
+
+  JsonDocument doc;
+  AJsonValue *root = doc.parse(small, options);
+  CHECK(root->isArenaOwned() && root->at(0ul).isArenaOwned());
+  CHECK(stats.allocations == 1 && doc.arena().mallocs() == 1);
+  // A new parse keeps the last chunk, enough for a small document again.
+  doc.parse(small, options);
+  CHECK(stats.allocations == 0 && doc.arena().chunks() == 1);
+  doc.parse(large, options);
+  CHECK(stats.allocations > 1);
+  size_t chunks = doc.arena().chunks();
+  CHECK(stats.allocations == chunks - 1);
+
+  // clear(true) keeps every chunk for the next document built there.
+  doc.clear(true);
+  CHECK(doc.root() == NULL && doc.arena().chunks() == 0);
+  AJsonValue *tree = Json::parse_raw(large.data(), large.size(), options,
+                                     &doc);
+  CHECK(stats.allocations == 0 && doc.arena().chunks() == chunks);
+  AJsonValue::release(tree);
+  doc.clear();
+  CHECK(doc.arena().chunks() <= 1 && doc.arena().used() == 0);
+
+  // So does a JsonParser, from one document to the next.
+  JsonParser parser(options);
+  for (size_t round = 0; round < 3; ++round) {
+    AJsonValue *parsed = parser.parse(large);
+    CHECK(parsed && parsed->isArenaOwned());
+    CHECK(round == 0 ? stats.allocations > 1 : stats.allocations == 0);
+    parsed = parser.parse(small);
+    CHECK(stats.allocations == 0);
+  }
+
+  // Nodes off the heap are not the arena's.
+  tree = Json::parse_raw(small.data(), small.size(), options);
+  CHECK(!tree->isArenaOwned() && stats.allocations == stats.totalNodes());
+  delete tree;
+}
+
+int main() {
+  test_allocate();
+  test_rewind();
+  test_reset();
+  test_document();
+  return test_result("arena");
+}
@@ -0,0 +1,100 @@
+#include "Json.hpp"
+#include "JsonDocument.hpp"
+#include "test.hpp"
+#include <stdexcept>
+#include <string>
+
+// Nesting deeper than maxDepth fails with "Maximum nesting depth exceeded!"
+// in both engines and in parseCompact; within the limit, trees nested far
+// deeper than the call stack allows are parsed, cloned, compared and
+// destroyed without recursion.
+
+static const size_t DEEP = 100000;
+
+static std::string nested(size_t depth, const std::string &inner = "") {
+  std::string s;
+  for (size_t i = 0; i < depth; ++i)
+    s += i % 3 == 2 ? "{\"k\":" : "[";
+  s += inner;
+  for (size_t i = depth; i--;)
+    s += i % 3 == 2 ? "}" : "]";
+  return s;
+}
+
+static ParseOptions limited(parse_engine engine, size_t maxDepth) {
+  ParseOptions options;
+  options.engine = engine;
+  options.maxDepth = maxDepth;
+  return options;
+}
+
+// The error parsing `input`, or "" when it parses.
+static std::string error(const std::string &input, parse_engine engine,
+                         size_t maxDepth, bool compact) {
+  try {
+    JsonDocument doc;
+    if (compact)
+      doc.parseCompact(input, maxDepth);
+    else
+      delete Json::parse_raw(input.data(), input.size(),
+                             limited(engine, maxDepth));
+  } catch (const std::exception &e) {
+    return e.what();
+  }
+  return "";
+}
+
+static void test_limit() {
+  static const std::string exceeded = "Maximum nesting depth exceeded!";
+  static const parse_engine engines[] = {TOKEN_ENGINE, STRUCTURAL_ENGINE};
+  for (size_t i = 0; i < 3; ++i) {
+    parse_engine engine = engines[i % 2];
+    bool compact = i == 2;
+    for (size_t depth = 1; depth <= 6; ++depth) {
+      std::string input = nested(depth, "1");
+      CHECK_INPUT(error(input, engine, depth, compact).empty(), input);
+      CHECK_INPUT(error(input, engine, depth - 1, compact) == exceeded,
+                  input);
+    }
+    // The default limit.
+    std::string input = nested(ParseOptions::DEFAULT_MAX_DEPTH + 1, "1");
+    CHECK(error(input, engine, ParseOptions::DEFAULT_MAX_DEPTH, compact) ==
+          exceeded);
+    input = nested(ParseOptions::DEFAULT_MAX_DEPTH, "1");
+    CHECK(error(input, engine, ParseOptions::DEFAULT_MAX_DEPTH, compact)
+              .empty());
+    CHECK(error("[[[[1, 2", engine, 3, compact) == exceeded);
+  }
+}
+
+static void test_deep() {
+  std::string input = nested(DEEP, "\"end\"");
+  static const parse_engine engines[] = {TOKEN_ENGINE, STRUCTURAL_ENGINE};
+  for (size_t i = 0; i < 2; ++i) {
+    ParseOptions options = limited(engines[i], DEEP);
+    AJsonValue *tree = Json::parse_raw(input.data(), input.size(), options);
+    AJsonValue *copy = tree->clone();
+    CHECK(tree->isEqual(*copy));
+    delete copy;
+
+    JsonDocument doc;
+    AJsonValue *other = doc.parse(input, options);
+    CHECK(other->isEqual(*tree));
+    delete tree;
+  }
+
+  JsonDocument doc;
+  const JsonValue &value = doc.parseCompact(input, DEEP);
+  AJsonValue *tree = value.toTree();
+  AJsonValue *expected = Json::parse_raw(input.data(), input.size(),
+                                         limited(TOKEN_ENGINE, DEEP));
+  CHECK(tree->isEqual(*expected));
+  delete expected;
+  delete tree;
+}
+
+int main() {
+  test_limit();
+  test_deep();
+  return test_result("depth");
+}
@@ -0,0 +1,97 @@
+#include "Json.hpp"
+#include "JsonDocument.hpp"
+#include "test.hpp"
+#include "utils.hpp"
+#include <string>
+
+// TOKEN_ENGINE and STRUCTURAL_ENGINE must build equal trees from valid
+// input (no tree at all from blank input), and fail with the same message
+// at the same offset otherwise.
+
+struct Outcome {
+  AJsonValue *tree;
+  bool failed;
+  std::string message;
+  size_t offset;
+};
+
+static Outcome parse(const std::string &input, parse_engine engine,
+                     JsonDocument *doc) {
+  ParseOptions options;
+  options.engine = engine;
+  Outcome outcome = {NULL, false, "", 0};
+  try {
+    outcome.tree = doc ? doc->parse(input, options)
+                       : Json::parse_raw(input.data(), input.size(), options);
+  } catch (const ParseError &e) {
+    outcome.failed = true;
+    outcome.message = e.what();
+    outcome.offset = e.offset();
+  }
+  return outcome;
+}
+
+static void compare(const std::string &input, bool inDocument) {
+  JsonDocument tokenDoc, structuralDoc;
+  Outcome token = parse(input, TOKEN_ENGINE, inDocument ? &tokenDoc : NULL);
+  Outcome structural =
+      parse(input, STRUCTURAL_ENGINE, inDocument ? &structuralDoc : NULL);
+  CHECK_INPUT(token.failed == structural.failed, input);
+  if (token.tree && structural.tree)
+    CHECK_INPUT(token.tree->isEqual(*structural.tree), input);
+  else
+    CHECK_INPUT(token.tree == structural.tree, input);
+  CHECK_INPUT(token.message == structural.message, input);
+  CHECK_INPUT(token.offset == structural.offset, input);
+  if (!inDocument) {
+    delete token.tree;
+    delete structural.tree;
+  }
+}
+
+// Object with `count` members of every kind, long enough for the
+// structural index to cross several 64-byte blocks.
+static std::string generated(size_t count) {
+  std::string s = "{";
+  for (size_t i = 0; i < count; ++i) {
+    std::string n = to_string(i);
+    if (i)
+      s += ",\n  ";
+    s += "\"key" + n + "\": [" + n + ", -" + n + ".5e-3, \"s\\\"" + n +
+         "\\\\\", true, false, null, {\"nested\": {\"k\": [[]]}}]";
+  }
+  return s + "}";
+}
+
+int main() {
+  static const char *const corpus[] = {
+      "{}", "[]", "0", "-1.5e10", "\"\"", "true", "null", " [ ] ",
+      "{\"a\": [1, 2.5, \"x\\\"y\", true, null, {\"b\": {}}], \"c\": \"\\\\\"}",
+      "[{\"k\": 1, \"k\": 2}, [], [[]], -3, \"a\\nb\"]",
+      "{\"a\" 1}", "{\"a\":}", "[1,]", "[1 2]", "{,}", "[\"abc", "\"\\q\"",
+      "01", "1.", "-", "1e", "[1]]", "{\"a\":1}}", "", "   ", "tru", "nul",
+      "[\"\\u12\"]", "{\"a\":[1,{\"b\":[2,{\"c\":}]}]}"};
+  size_t corpusSize = sizeof(corpus) / sizeof(*corpus);
+  for (size_t i = 0; i < corpusSize; ++i) {
+    compare(corpus[i], false);
+    compare(corpus[i], true);
+  }
+
+  MappedFile config("config.json");
+  std::string large = generated(2000);
+  compare(std::string(config.data(), config.size()), false);
+  compare(large, false);
+  compare(large, true);
+  for (size_t cut = 1; cut < 400; cut += 37)
+    compare(large.substr(0, large.size() - cut), false);
+
+  TestRandom rnd(1);
+  for (size_t i = 0; i < 20000; ++i) {
+    std::string input = corpus[rnd.below(10)];
+    mutate_json(input, rnd);
+    if (rnd.below(5) == 0)
+      input = input + input + input;
+    compare(input, rnd.below(2) != 0);
+  }
+  return test_result("engines");
+}
@@ -0,0 +1,103 @@
+#include "Json.hpp"
+#include "JsonDocument.hpp"
+#include "JsonTypes.hpp"
+#include "test.hpp"
+#include "utils.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+// MappedFile maps a regular file, reads an empty one into its buffer, and
+// throws when the file cannot be opened; Json::parseFile() and
+// JsonDocument::parseFile() parse what a MappedFile sees, the latter keeping
+// the file for string views.
+
+// A new temporary file holding `content`.
+static std::string temp_file(const std::string &content) {
+  char name[] = "/tmp/json_test_XXXXXX";
+  int fd = mkstemp(name);
+  CHECK(fd >= 0);
+  if (fd >= 0) {
+    CHECK(write(fd, content.data(), content.size()) ==
+          static_cast<ssize_t>(content.size()));
+    close(fd);
+  }
+  return name;
+}
+
+// The error opening or parsing `name`, or "" when it parses.
+static std::string parse_error(const std::string &name) {
+  try {
+    delete Json::parseFile(name);
+  } catch (const std::exception &e) {
+    return e.what();
+  }
+  return "";
+}
+
+static void test_file(const std::string &content) {
+  std::string name = temp_file(content);
+  {
+    MappedFile file(name);
+    CHECK_INPUT(std::string(file.data(), file.size()) == content, content);
+    CHECK_INPUT(file.isMapped() == !content.empty(), content);
+  }
+
+  AJsonValue *parsed = Json::parseFile(name);
+  AJsonValue *expected = Json::parse_raw(content);
+  CHECK_INPUT(parsed && expected && parsed->isEqual(*expected), content);
+  delete parsed;
+
+  ParseOptions options;
+  options.stringViews = true;
+  delete Json::parseFile(name, options);
+  JsonDocument doc;
+  AJsonValue *root = doc.parseFile(name, options);
+  std::remove(name.c_str());
+  // The document still maps the removed file its strings point into.
+  CHECK_INPUT(root && root->isEqual(*expected), content);
+  CHECK_INPUT(root->at("name").asJsonString()->isView(), content);
+  delete expected;
+}
+
+int main() {
+  test_file("{\"name\": \"value\", \"list\": [1, 2.5, null]}\n");
+  std::string large = "{\"name\": \"large\", \"list\": [";
+  for (size_t i = 0; i < 100000; ++i)
+    large += i ? ", \"item\"" : "\"item\"";
+  test_file(large + "]}");
+
+  // An empty file is not mapped, and holds no value.
+  std::string empty = temp_file("");
+  {
+    MappedFile file(empty);
+    CHECK(file.size() == 0 && !file.isMapped());
+  }
+  CHECK(Json::parseFile(empty) == NULL);
+  std::remove(empty.c_str());
+
+  std::string bad = temp_file("{\"name\": ");
+  CHECK(parse_error(bad) == "Malformed JSON file!");
+  std::remove(bad.c_str());
+
+  std::string missing = "/tmp/json_test_missing/file.json";
+  CHECK(parse_error(missing) == "Could not open file: " + missing);
+  bool thrown = false;
+  try {
+    MappedFile file(missing);
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  JsonDocument doc;
+  thrown = false;
+  try {
+    doc.parseFile(missing);
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  return test_result("files");
+}
@@ -0,0 +1,122 @@
+#include "JsonDocument.hpp"
+#include "JsonKey.hpp"
+#include "JsonTypes.hpp"
+#include "test.hpp"
+#include "utils.hpp"
+#include <string>
+#include <vector>
+
+// A KeyPool interns each distinct key once: the same text gives the same
+// entry, hence the same text pointer, and the hash a key of its own would
+// compute. clear(true) reuses the entries for the next document, and
+// documents parsed apart agree on their keys' hashes and equality.
+
+static std::string key_text(size_t i) {
+  return i % 5 ? "key" + to_string(i) : std::string(i % 3, '/');
+}
+
+static void test_pool() {
+  KeyPool pool;
+  std::vector<JsonKey> keys;
+  // Enough keys for the table to grow several times.
+  for (size_t i = 0; i < 500; ++i) {
+    std::string text = key_text(i);
+    keys.push_back(pool.intern(text.data(), text.size()));
+  }
+  size_t distinct = pool.size();
+  CHECK(distinct == 403);
+
+  std::vector<const char *> first;
+  for (size_t round = 0; round < 3; ++round) {
+    for (size_t i = 0; i < 500; ++i) {
+      std::string text = key_text(i);
+      JsonKey key = pool.intern(text.data(), text.size());
+      CHECK_INPUT(key.isInterned() && key.str() == text, text);
+      CHECK_INPUT(key.data() == keys[i].data() && key == keys[i], text);
+      CHECK_INPUT(key.hash() == JsonKey::hash(text.data(), text.size()),
+                  text);
+      CHECK_INPUT(key.hash() == JsonKey(text).hash(), text);
+      CHECK_INPUT(key == JsonKey(text) && !JsonKey(text).isInterned(),
+                  text);
+      if (i && key_text(i - 1) != text)
+        CHECK_INPUT(key != keys[i - 1] && key.data() != keys[i - 1].data(),
+                    text);
+    }
+    CHECK(pool.size() == distinct);
+
+    // Interned again in the same order, the keys land on the same entries.
+    pool.clear(true);
+    CHECK(pool.size() == 0);
+    keys.clear();
+    for (size_t i = 0; i < 500; ++i) {
+      std::string text = key_text(i);
+      keys.push_back(pool.intern(text.data(), text.size()));
+      if (round == 0)
+        first.push_back(keys.back().data());
+      else
+        CHECK_INPUT(keys.back().data() == first[i], text);
+    }
+    CHECK(pool.size() == distinct);
+  }
+
+  size_t hash = keys[1].hash();
+  pool.clear();
+  JsonKey key = pool.intern("key1", 4);
+  CHECK(pool.size() == 1 && key == JsonKey("key1") && key.hash() == hash);
+}
+
+// The keys of the objects of `root`, in document order.
+static std::vector<JsonKey> object_keys(const AJsonValue *root) {
+  std::vector<JsonKey> keys;
+  const JsonArray &array = root->asRefArray();
+  for (size_t i = 0; i < array.elements.size(); ++i) {
+    const JsonObject &object = array.elements[i]->asRefObject();
+    for (JsonObject::const_iterator it = object.members.begin();
+         it != object.members.end(); ++it)
+      keys.push_back(it->first);
+  }
+  return keys;
+}
+
+static void test_documents() {
+  std::string text = "[";
+  for (size_t i = 0; i < 50; ++i)
+    text += (i ? ", {\"id\": " : "{\"id\": ") + to_string(i) +
+            ", \"name\": \"n\", \"" + key_text(i) + "\": true}";
+  text += "]";
+
+  JsonDocument doc, other;
+  std::vector<JsonKey> keys = object_keys(doc.parse(text));
+  std::vector<JsonKey> otherKeys = object_keys(other.parse(text));
+  CHECK(keys.size() == 150 && otherKeys.size() == keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    CHECK_INPUT(keys[i].isInterned(), keys[i].str());
+    CHECK_INPUT(keys[i] == otherKeys[i], keys[i].str());
+    CHECK_INPUT(keys[i].hash() == otherKeys[i].hash(), keys[i].str());
+    CHECK_INPUT(keys[i].data() != otherKeys[i].data(), keys[i].str());
+    // Within a document, every occurrence shares one entry.
+    for (size_t j = 0; j < i; ++j)
+      if (keys[j].str() == keys[i].str())
+        CHECK_INPUT(keys[j].data() == keys[i].data(), keys[i].str());
+  }
+  CHECK(doc.keys().size() == other.keys().size());
+
+  // The same entries again once the document is cleared keeping them.
+  std::vector<const char *> data;
+  for (size_t i = 0; i < keys.size(); ++i)
+    data.push_back(keys[i].data());
+  doc.clear(true);
+  AJsonValue *root = Json::parse_raw(text.data(), text.size(),
+                                     ParseOptions(), &doc);
+  keys = object_keys(root);
+  for (size_t i = 0; i < keys.size(); ++i)
+    CHECK_INPUT(keys[i].data() == data[i] && keys[i] == otherKeys[i],
+                keys[i].str());
+  AJsonValue::release(root);
+}
+
+int main() {
+  test_pool();
+  test_documents();
+  return test_result("keys");
+}
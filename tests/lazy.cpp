@@ -0,0 +1,58 @@
+#include "LazyDocument.hpp"
+#include "test.hpp"
+#include "utils.hpp"
+#include <string>
+
+// Walking a LazyValue forward with first() and next() visits the same items
+// as indexing it, and each step does not depend on the size of the
+// container.
+
+static void test_items() {
+  LazyDocument doc;
+  LazyValue root = doc.parse(
+      "{\"a\": [1, [2, 3], {\"x\": 4}, \"s\"], \"b\": {}, \"a\\\"q\": null,"
+      " \"c\": []}");
+  const char *const keys[] = {"a", "b", "a\"q", "c"};
+  size_t n = 0;
+  for (LazyValue member = root.first(); member; member = member.next(), ++n)
+    CHECK(n < 4 && member.key() == keys[n]);
+  CHECK(n == root.size());
+
+  LazyValue list = root["a"];
+  n = 0;
+  for (LazyValue item = list.first(); item; item = item.next(), ++n) {
+    CHECK(item.getType() == list[n].getType());
+    CHECK(item.key().empty());
+  }
+  CHECK(n == list.size());
+  CHECK(list[2].first().key() == "x");
+  CHECK(list[2].first().asNumber() == 4);
+  CHECK(list[1].first().next().asNumber() == 3);
+  CHECK(!list[1].first().next().next());
+  CHECK(!root["b"].first() && !root["c"].first());
+  CHECK(!root.next() && !list[3].first());
+}
+
+static void test_large() {
+  std::string s = "[";
+  for (size_t i = 0; i < 200000; ++i)
+    s += (i ? ",{\"v\":" : "{\"v\":") + to_string(i) + "}";
+  s += "]";
+  LazyDocument doc;
+  LazyValue root = doc.parse(s);
+  double start = monotonic_seconds();
+  long sum = 0, expected = 0;
+  size_t n = 0;
+  for (LazyValue item = root.first(); item; item = item.next(), ++n) {
+    sum += item["v"].asNumber();
+    expected += static_cast<long>(n);
+  }
+  CHECK(n == 200000 && sum == expected);
+  CHECK(monotonic_seconds() - start < 10.0);
+}
+
+int main() {
+  test_items();
+  test_large();
+  return test_result("lazy");
+}
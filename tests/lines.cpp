@@ -0,0 +1,82 @@
+#include "JsonLines.hpp"
+#include "JsonValidator.hpp"
+#include "test.hpp"
+#include "utils.hpp"
+#include <string>
+#include <vector>
+
+// JsonLines::validate() reports one result per record, in input order and
+// with its 1-based line number, whatever the number of threads; blank lines
+// count as lines but give no record.
+
+static std::string outcome(const std::vector<LineResult> &results) {
+  std::string s;
+  for (size_t i = 0; i < results.size(); ++i) {
+    s += to_string(results[i].line) + (results[i].valid ? " ok" : " bad");
+    for (size_t j = 0; j < results[i].errors.size(); ++j)
+      s += " " + results[i].errors[j].path + ": " + results[i].errors[j].msg;
+    s += "\n";
+  }
+  return s;
+}
+
+static std::vector<LineResult> run(const std::string &input,
+                                   const AJsonValidator &schema,
+                                   size_t threads) {
+  std::vector<LineResult> results;
+  JsonLines::validate(input.data(), input.size(), schema, results, threads);
+  return results;
+}
+
+int main() {
+  ObjectValidator schema = obj();
+  schema.property("id", num().min(0)).property("name", str().notEmpty());
+
+  std::vector<LineResult> results = run("", schema, 0);
+  CHECK(results.empty());
+  CHECK(run("\n  \n\r\n", schema, 4).empty());
+
+  // Blank lines, CRLF endings, a malformed record and no final newline.
+  std::string input = "{\"id\": 1, \"name\": \"a\"}\n"
+                      "\n"
+                      "{\"id\": -1, \"name\": \"b\"}\r\n"
+                      "   \t\n"
+                      "{\"id\": 2, \"name\": \r\n"
+                      "{\"id\": 3, \"name\": \"\"}\r\n"
+                      "{\"id\": 4, \"name\": \"d\"}";
+  results = run(input, schema, 1);
+  CHECK(results.size() == 5);
+  if (results.size() == 5) {
+    CHECK(results[0].line == 1 && results[0].valid);
+    CHECK(results[1].line == 3 && !results[1].valid);
+    CHECK(results[1].errors.size() == 1 && results[1].errors[0].path == "id");
+    CHECK(results[2].line == 5 && !results[2].valid);
+    CHECK(results[2].errors.size() == 1 &&
+          results[2].errors[0].msg == "Malformed JSON file!");
+    CHECK(results[3].line == 6 && !results[3].valid);
+    CHECK(results[4].line == 7 && results[4].valid);
+  }
+
+  // Enough records for several batches: the same results on any number of
+  // threads.
+  std::string many;
+  for (size_t i = 0; i < 5000; ++i) {
+    if (i % 7 == 0)
+      many += "\n";
+    if (i % 11 == 0)
+      many += "{\"id\": " + to_string(i) + ", \"name\": ";
+    else
+      many += "{\"id\": " + to_string(static_cast<long>(i % 13) - 1) +
+              ", \"name\": \"" + std::string(i % 3, 'x') + "\"}";
+    many += i % 2 ? "\r\n" : "\n";
+  }
+  std::string expected = outcome(run(many, schema, 1));
+  CHECK(run(many, schema, 1).size() == 5000);
+  CHECK(outcome(run(many, schema, 0)) == expected);
+  CHECK(outcome(run(many, schema, 3)) == expected);
+  results = run(many, schema, 16);
+  CHECK(outcome(results) == expected);
+  for (size_t i = 1; i < results.size(); ++i)
+    CHECK_INPUT(results[i - 1].line < results[i].line, to_string(i));
+  return test_result("lines");
+}
@@ -0,0 +1,101 @@
+#include "parser.hpp"
+#include "test.hpp"
+#include "utils.hpp"
+#include <clocale>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// The tokenizer must convert every fraction and exponent to the same double
+// as strtod in the C locale, whichever of its paths it takes, and still do
+// so once the program has switched to a locale with a decimal comma.
+
+static std::string digits(TestRandom &rnd, size_t count, bool leading) {
+  std::string s;
+  for (size_t i = 0; i < count; ++i)
+    s += static_cast<char>('0' + rnd.below(10));
+  if (leading && !s.empty() && s[0] == '0' && s.size() > 1)
+    s[0] = static_cast<char>('1' + rnd.below(9));
+  return s;
+}
+
+// Short mantissas take the fast path, long ones and large exponents the
+// slow one; exponents reach the subnormal and overflowing ranges.
+static std::string random_number(TestRandom &rnd) {
+  std::string s = rnd.below(2) ? "-" : "";
+  size_t length = rnd.below(4) == 0 ? 1 + rnd.below(40) : 1 + rnd.below(17);
+  std::string mantissa = digits(rnd, length, true);
+  size_t point = rnd.below(mantissa.size() + 1);
+  if (point == 0)
+    s += "0." + mantissa;
+  else if (point == mantissa.size())
+    s += mantissa;
+  else
+    s += mantissa.substr(0, point) + "." + mantissa.substr(point);
+  if (point == mantissa.size() || rnd.below(2)) {
+    s += rnd.below(2) ? "e" : "E";
+    size_t roll = rnd.below(8);
+    if (roll == 0)
+      s += "-";
+    else if (roll == 1)
+      s += "+";
+    int exponent = roll < 4 ? static_cast<int>(rnd.below(30))
+                            : static_cast<int>(rnd.below(340));
+    if (rnd.below(8) == 0)
+      s += "0";
+    s += to_string(exponent);
+  }
+  return s;
+}
+
+static void check(const std::string &text) {
+  Tokenizer tz(text.data(), text.data() + text.size());
+  token tk;
+  tz.next(tk);
+  double expected = std::strtod(text.c_str(), NULL);
+  CHECK_INPUT(tk.type == TK_DOUBLE, text);
+  CHECK_INPUT(tz.offset() == text.size(), text);
+  CHECK_INPUT(std::memcmp(&tk.real, &expected, sizeof(double)) == 0, text);
+}
+
+int main() {
+  static const char *const corpus[] = {
+      "0.0", "-0.0", "1e0", "0.1", "0.30000000000000004", "9007199254740993.0",
+      "9007199254740992.000000000000000000001", "1.7976931348623157e308",
+      "1.7976931348623159e308", "1e400", "-1e400", "4.9406564584124654e-324",
+      "2.4703282292062327e-324", "2.4703282292062328e-324", "1e-400",
+      "2.2250738585072011e-308", "123456789012345678901234567890.5",
+      "0.000000000000000000000000000000000000000000001e45", "1e23",
+      "8.98846567431158e307", "3.14159265358979323846264338327950288"};
+  TestRandom rnd(14);
+  std::vector<std::string> numbers(20000);
+  for (size_t i = 0; i < numbers.size(); ++i)
+    numbers[i] = random_number(rnd);
+
+  for (size_t i = 0; i < sizeof(corpus) / sizeof(*corpus); ++i)
+    check(corpus[i]);
+  for (size_t i = 0; i < numbers.size(); ++i)
+    check(numbers[i]);
+
+  // strtod now expects a comma: compare with the values read before.
+  static const char *const commaLocales[] = {"de_DE.UTF-8", "fr_FR.UTF-8",
+                                             "de_DE", "fr_FR"};
+  for (size_t i = 0; i < 4; ++i) {
+    if (!std::setlocale(LC_NUMERIC, commaLocales[i]))
+      continue;
+    for (size_t n = 0; n < 2000; ++n) {
+      std::setlocale(LC_NUMERIC, "C");
+      double expected = std::strtod(numbers[n].c_str(), NULL);
+      std::setlocale(LC_NUMERIC, commaLocales[i]);
+      Tokenizer tz(numbers[n].data(), numbers[n].data() + numbers[n].size());
+      token tk;
+      tz.next(tk);
+      CHECK_INPUT(std::memcmp(&tk.real, &expected, sizeof(double)) == 0,
+                  numbers[n]);
+    }
+    std::setlocale(LC_NUMERIC, "C");
+    break;
+  }
+  return test_result("numbers");
+}
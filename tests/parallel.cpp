@@ -0,0 +1,112 @@
+#include "Json.hpp"
+#include "JsonDocument.hpp"
+#include "test.hpp"
+#include "utils.hpp"
+#include <string>
+
+// JsonDocument::parseParallel() must build the tree parse() builds, on any
+// number of threads, and fail with parse()'s error wherever the input is
+// malformed, the middle of a large array included.
+
+struct Outcome {
+  bool failed;
+  std::string message;
+  size_t offset;
+};
+
+// parse() when `parallel` is unset.
+static Outcome parse(const std::string &input, bool parallel, size_t threads,
+                     JsonDocument &doc, AJsonValue *&tree) {
+  Outcome outcome = {false, "", 0};
+  tree = NULL;
+  try {
+    tree = parallel ? doc.parseParallel(input.data(), input.size(),
+                                        ParseOptions(), threads)
+                    : doc.parse(input);
+  } catch (const ParseError &e) {
+    outcome.failed = true;
+    outcome.message = e.what();
+    outcome.offset = e.offset();
+  }
+  return outcome;
+}
+
+// Whether the input was rejected.
+static bool compare(const std::string &input, size_t threads) {
+  JsonDocument serialDoc, parallelDoc;
+  AJsonValue *serial, *parallel;
+  Outcome expected = parse(input, false, 0, serialDoc, serial);
+  Outcome got = parse(input, true, threads, parallelDoc, parallel);
+  CHECK_INPUT(got.failed == expected.failed, input.substr(0, 80));
+  CHECK_INPUT(got.message == expected.message, input.substr(0, 80));
+  CHECK_INPUT(got.offset == expected.offset, input.substr(0, 80));
+  if (serial && parallel)
+    CHECK_INPUT(serial->isEqual(*parallel), input.substr(0, 80));
+  else
+    CHECK_INPUT(serial == parallel, input.substr(0, 80));
+  return got.failed;
+}
+
+// Array of `count` elements of every kind, nested ones included.
+static std::string generated(size_t count) {
+  std::string s = "[";
+  for (size_t i = 0; i < count; ++i) {
+    std::string n = to_string(i);
+    if (i)
+      s += ",\n ";
+    switch (i % 5) {
+    case 0:
+      s += "{\"id\": " + n + ", \"tags\": [\"a\", \"b\\\"" + n +
+           "\"], \"ok\": true, \"none\": null}";
+      break;
+    case 1:
+      s += "[" + n + ", -" + n + ".25e-2, [], {}]";
+      break;
+    case 2:
+      s += "\"string " + n + " \\u00e9\"";
+      break;
+    case 3:
+      s += n;
+      break;
+    default:
+      s += "{\"nested\": {\"deeper\": [[" + n + "]]}}";
+    }
+  }
+  return s + "]";
+}
+
+int main() {
+  static const size_t threads[] = {0, 1, 2, 7};
+  std::string large = generated(20000);
+  for (size_t t = 0; t < 4; ++t) {
+    CHECK(!compare(large, threads[t]));
+
+    // A malformed element half-way, and one near the end.
+    std::string broken = large;
+    broken.insert(broken.size() / 2, "}");
+    CHECK(compare(broken, threads[t]));
+    broken = large;
+    broken.insert(broken.size() - 40, "[1 2]");
+    CHECK(compare(broken, threads[t]));
+    CHECK(compare(large.substr(0, large.size() - 1), threads[t]));
+    CHECK(compare(large + " x", threads[t]));
+  }
+
+  // Roots other than an array, and arrays too short to split, fall back.
+  static const char *const corpus[] = {
+      "{\"a\": [1, 2], \"b\": {}}", "\"text\"", "42", "", "  ", "[]", "[1]",
+      "[1,]", "[,1]", "[[1], [2]", " [ 1 , {\"k\" : [ ] } ] "};
+  for (size_t i = 0; i < sizeof(corpus) / sizeof(*corpus); ++i)
+    for (size_t t = 0; t < 4; ++t)
+      compare(corpus[i], threads[t]);
+
+  // A document is reused from one parallel parse to the next.
+  JsonDocument doc;
+  JsonDocument serialDoc;
+  AJsonValue *expected = serialDoc.parse(large);
+  for (size_t round = 0; round < 3; ++round) {
+    AJsonValue *tree = doc.parseParallel(large.data(), large.size());
+    CHECK(tree && tree->isEqual(*expected));
+  }
+  return test_result("parallel");
+}
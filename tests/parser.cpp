@@ -0,0 +1,55 @@
+#include "JsonParser.hpp"
+#include "JsonTypes.hpp"
+#include "test.hpp"
+#include "utils.hpp"
+#include <cstdlib>
+#include <new>
+#include <string>
+
+// A JsonParser that has seen a document stops allocating for its keys when
+// it parses a similar one: only the member storage of the objects remains.
+// Its arena chunks are reused too, and the statistics do not count them.
+
+static size_t allocations = 0;
+
+void *operator new(std::size_t size) throw(std::bad_alloc) {
+  ++allocations;
+  void *p = std::malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) throw() { std::free(p); }
+
+// One object of `count` members whose keys are too long for the small
+// string buffer of std::string.
+static std::string document(size_t count, const std::string &prefix) {
+  std::string s = "{";
+  for (size_t i = 0; i < count; ++i) {
+    if (i)
+      s += ",";
+    s += "\"" + prefix + to_string(i) + "\":" + to_string(i);
+  }
+  return s + "}";
+}
+
+int main() {
+  std::string first = document(1000, "a_rather_long_member_key_");
+  std::string second = document(1000, "the_other_doc_member_key_");
+  ParseStats stats;
+  JsonParser parser;
+  parser.options().stats = &stats;
+  AJsonValue *root = parser.parse(first);
+  CHECK(root && root->asObject()->size() == 1000);
+  CHECK(stats.allocations > 0);
+
+  size_t before = allocations;
+  root = parser.parse(second);
+  size_t used = allocations - before;
+  CHECK(root && root->asObject()->size() == 1000);
+  CHECK((*root)["the_other_doc_member_key_999"].asNumber() == 999);
+  CHECK(used < 100);
+  CHECK(stats.allocations == 0);
+  return test_result("parser");
+}
@@ -0,0 +1,98 @@
+#include "JsonHandler.hpp"
+#include "JsonPushParser.hpp"
+#include "test.hpp"
+#include "utils.hpp"
+#include <stdexcept>
+#include <string>
+
+// Feeding a document to JsonPushParser in chunks must give the same events
+// and the same outcome as feeding it whole, wherever the cuts fall.
+
+class EventLog : public JsonHandler {
+public:
+  std::string log;
+
+  bool onObjectStart() { return add("{"); }
+  bool onKey(const std::string &key) { return add("k:" + key); }
+  bool onObjectEnd() { return add("}"); }
+  bool onArrayStart() { return add("["); }
+  bool onArrayEnd() { return add("]"); }
+  bool onString(const std::string &value) { return add("s:" + value); }
+  bool onNumber(long value) { return add("n:" + to_string(value)); }
+  bool onDouble(double value) { return add("d:" + to_string(value)); }
+  bool onBool(bool value) { return add(value ? "true" : "false"); }
+  bool onNull() { return add("null"); }
+
+private:
+  bool add(const std::string &event) {
+    log += event;
+    log += '\n';
+    return true;
+  }
+};
+
+// Events, then the error if the parse threw. `cuts` are the chunk sizes,
+// repeated over the input; an empty list feeds it whole.
+static std::string run(const std::string &input,
+                       const std::vector<size_t> &cuts) {
+  EventLog events;
+  JsonPushParser parser(events);
+  try {
+    size_t at = 0;
+    for (size_t i = 0; at < input.size(); ++i) {
+      size_t size = cuts.empty() ? input.size() : cuts[i % cuts.size()];
+      if (size > input.size() - at)
+        size = input.size() - at;
+      parser.feed(input.data() + at, size);
+      at += size;
+    }
+    parser.finish();
+  } catch (const std::runtime_error &e) {
+    events.log += "error: ";
+    events.log += e.what();
+  }
+  return events.log;
+}
+
+static void compare(const std::string &input, TestRandom &rnd) {
+  std::string whole = run(input, std::vector<size_t>());
+  std::vector<size_t> cuts(1, 1);
+  CHECK_INPUT(run(input, cuts) == whole, input);
+  for (size_t split = 1; split < input.size() && split < 64; ++split) {
+    cuts.assign(1, split);
+    cuts.push_back(input.size());
+    CHECK_INPUT(run(input, cuts) == whole, input);
+  }
+  cuts.clear();
+  for (size_t i = 0; i < 8; ++i)
+    cuts.push_back(rnd.below(12));
+  cuts.push_back(1);
+  CHECK_INPUT(run(input, cuts) == whole, input);
+}
+
+int main() {
+  static const char *const corpus[] = {
+      "{\"a\": [1, 2.5, \"x\\\"y\", true, null, {\"b\": {}}], \"c\": \"\\\\\"}",
+      "[{\"k\": 1, \"k\": 2}, [], [[]], -3, \"a\\nb\", -0.5e+10, 123456789]",
+      "{\"escapes\": \"\\\\\\\\\\\"\\u00e9\\n\", \"\\\\\": false}",
+      "{}", "[]", "[1,]", "{\"a\" 1}", "[tru]", "[1.]", "[\"abc", "[1 2]",
+      "{\"a\":1}}", "[-]", "[nul]", "[truex]"};
+  size_t corpusSize = sizeof(corpus) / sizeof(*corpus);
+  TestRandom rnd(12);
+  for (size_t i = 0; i < corpusSize; ++i)
+    compare(corpus[i], rnd);
+  for (size_t i = 0; i < 3000; ++i) {
+    std::string input = corpus[rnd.below(3)];
+    mutate_json(input, rnd);
+    compare(input, rnd);
+  }
+
+  // A token spanning many chunks is tokenized once, not once per chunk.
+  std::string big = "[\"" + std::string(1 << 20, 'x') + "\", " +
+                    std::string(1 << 16, '7') + "0e-65536]";
+  double start = monotonic_seconds();
+  std::vector<size_t> cuts(1, 1);
+  CHECK(run(big, cuts) == run(big, std::vector<size_t>()));
+  CHECK(monotonic_seconds() - start < 10.0);
+  return test_result("push");
+}
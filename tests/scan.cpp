@@ -0,0 +1,79 @@
+#include "scan.hpp"
+#include "test.hpp"
+#include <cctype>
+#include <string>
+
+// The vector kernels picked for this CPU must agree with plain byte loops
+// at every alignment and length, including the tails shorter than a vector.
+
+static const char *skip_whitespace_bytes(const char *p, const char *end) {
+  while (p < end && std::isspace(static_cast<unsigned char>(*p)))
+    p++;
+  return p;
+}
+
+static const char *find_string_special_bytes(const char *p, const char *end) {
+  while (p < end && *p != '"' && *p != '\\')
+    p++;
+  return p;
+}
+
+static void classify_block_bytes(const char *block, BlockMasks &masks) {
+  static const std::string ops = "{}[]:,";
+  masks.quote = masks.backslash = masks.space = masks.op = 0;
+  for (unsigned i = 0; i < 64; ++i) {
+    uint64_t bit = static_cast<uint64_t>(1) << i;
+    unsigned char c = block[i];
+    if (c == '"')
+      masks.quote |= bit;
+    else if (c == '\\')
+      masks.backslash |= bit;
+    else if (std::isspace(c))
+      masks.space |= bit;
+    else if (c && ops.find(static_cast<char>(c)) != std::string::npos)
+      masks.op |= bit;
+  }
+}
+
+// Mostly whitespace or mostly plain text, with the odd byte of every kind,
+// high bytes included.
+static std::string random_bytes(TestRandom &rnd, size_t length, bool spaces) {
+  static const char common[] = " \t\n\r\v\f\"\\{}[]:,a0-\x80\xff";
+  std::string s(length, spaces ? ' ' : 'x');
+  for (size_t i = 0; i < length; ++i) {
+    size_t roll = rnd.below(16);
+    if (roll == 0)
+      s[i] = static_cast<char>(rnd.below(256));
+    else if (roll < 4)
+      s[i] = common[rnd.below(sizeof(common) - 1)];
+    else if (spaces && roll < 6)
+      s[i] = "\t\n\r"[rnd.below(3)];
+  }
+  return s;
+}
+
+int main() {
+  TestRandom rnd(9);
+  for (size_t round = 0; round < 20000; ++round) {
+    std::string s = random_bytes(rnd, rnd.below(200), round % 2 == 0);
+    const char *begin = s.data();
+    const char *end = begin + s.size();
+    for (size_t start = 0; start <= s.size() && start < 40; ++start) {
+      const char *p = begin + start;
+      CHECK_INPUT(skip_whitespace(p, end) == skip_whitespace_bytes(p, end), s);
+      CHECK_INPUT(find_string_special(p, end) ==
+                      find_string_special_bytes(p, end),
+                  s);
+    }
+    if (s.size() < 64)
+      continue;
+    size_t at = rnd.below(s.size() - 63);
+    BlockMasks got, want;
+    classify_block(begin + at, got);
+    classify_block_bytes(begin + at, want);
+    CHECK_INPUT(got.quote == want.quote && got.backslash == want.backslash &&
+                    got.space == want.space && got.op == want.op,
+                s);
+  }
+  return test_result("scan");
+}
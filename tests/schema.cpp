@@ -0,0 +1,302 @@
+#include "CompiledSchema.hpp"
+#include "Json.hpp"
+#include "JsonDocument.hpp"
+#include "JsonValidator.hpp"
+#include "schema.hpp"
+#include "test.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+
+// A CompiledSchema must accept what the validator tree it was built from
+// accepts, and report the same errors in the same order, on random schemas
+// and random documents over the same few keys. So must a SchemaHandler fed
+// the text, repeated keys included; stopping at the first error, it reports
+// some of those errors and fails exactly when there are any. Validation
+// capped at n errors reports n errors, the first n of the full list unless
+// an OR without a message of its own picks between branches that both
+// reach the limit.
+
+static const char *const keys[] = {"a", "b", "c", "dd", "/x", "12", "e"};
+
+// Set by random_schema() when an OR reports the errors of a branch.
+static bool branchErrors = false;
+
+static AJsonValidator *random_schema(TestRandom &rnd, bool defaults,
+                                     size_t depth);
+
+static AJsonValidator *random_string(TestRandom &rnd, bool defaults) {
+  StringValidator s = str();
+  if (rnd.below(3) == 0)
+    s.min(rnd.below(4));
+  if (rnd.below(3) == 0)
+    s.max(rnd.below(4));
+  if (rnd.below(3) == 0)
+    s.notEmpty();
+  if (rnd.below(4) == 0)
+    s.isDigit();
+  if (rnd.below(4) == 0)
+    s.isStartWith('/');
+  if (rnd.below(5) == 0)
+    s.isEqual("a");
+  if (rnd.below(5) == 0)
+    s.optional();
+  if (defaults && rnd.below(5) == 0)
+    s.withDefault("z");
+  return s.clone();
+}
+
+static AJsonValidator *random_number(TestRandom &rnd, bool defaults) {
+  NumberValidator n = num();
+  long low = static_cast<long>(rnd.below(5)) - 2;
+  long high = static_cast<long>(rnd.below(5)) - 2;
+  switch (rnd.below(4)) {
+  case 1:
+    n.min(low);
+    break;
+  case 2:
+    n.max(high);
+    break;
+  case 3:
+    n.range(low, high);
+  }
+  if (rnd.below(5) == 0)
+    n.optional();
+  if (defaults && rnd.below(5) == 0)
+    n.withDefault(1);
+  return n.clone();
+}
+
+// Closed or not, with a few properties or with enough of them for the
+// compiled hash table, or matching every key.
+static AJsonValidator *random_object(TestRandom &rnd, bool defaults,
+                                     size_t depth) {
+  ObjectValidator o = obj();
+  if (rnd.below(4) == 0) {
+    StringValidator name = str();
+    if (rnd.below(2))
+      name.isStartWith('/');
+    if (rnd.below(2))
+      name.max(2);
+    AJsonValidator *value = random_schema(rnd, defaults, depth + 1);
+    o.match(name, *value);
+    delete value;
+  } else {
+    size_t count = rnd.below(25);
+    for (size_t i = 0; i < count; ++i) {
+      std::string key = count > 7 ? std::string("k") + char('a' + i)
+                                  : keys[rnd.below(7)];
+      if (count > 7 && i == 0)
+        key = "a";
+      AJsonValidator *value = random_schema(rnd, defaults, depth + 1);
+      o.property(key, *value);
+      delete value;
+      if (rnd.below(4) == 0)
+        o.optional();
+    }
+  }
+  if (rnd.below(3) == 0)
+    o.allowAdditional(false);
+  if (rnd.below(4) == 0)
+    o.notEmpty();
+  return o.clone();
+}
+
+static AJsonValidator *random_schema(TestRandom &rnd, bool defaults,
+                                     size_t depth) {
+  static const json_type types[] = {NIL, NUMBER, STRING, DOUBLE, OBJECT};
+  switch (rnd.below(depth > 3 ? 5 : 8)) {
+  case 0:
+    return random_string(rnd, defaults);
+  case 1:
+    return random_number(rnd, defaults);
+  case 2: {
+    BoolValidator b = Bool();
+    if (rnd.below(4) == 0)
+      b.optional();
+    if (defaults && rnd.below(4) == 0)
+      b.withDefault(true);
+    return b.clone();
+  }
+  case 3:
+    return new TypeValidator(types[rnd.below(5)]);
+  case 4: {
+    ORValidator any = Or();
+    for (size_t n = rnd.below(4); n; --n) {
+      AJsonValidator *branch = random_schema(rnd, defaults, depth + 1);
+      any.addConditions(*branch);
+      delete branch;
+    }
+    if (rnd.below(3) == 0)
+      any.withMsg("bad any");
+    else
+      branchErrors = true;
+    return any.clone();
+  }
+  case 5:
+  case 6:
+    return random_object(rnd, defaults, depth);
+  default: {
+    ArrayValidator a = arr();
+    if (rnd.below(2)) {
+      AJsonValidator *item = random_schema(rnd, defaults, depth + 1);
+      a.item(*item);
+      delete item;
+    }
+    if (rnd.below(3) == 0)
+      a.min(rnd.below(3));
+    if (rnd.below(3) == 0)
+      a.max(rnd.below(3));
+    return a.clone();
+  }
+  }
+}
+
+// The root is a container; keys repeat now and then when `repeat` is set.
+static std::string random_document(TestRandom &rnd, bool repeat,
+                                   size_t depth) {
+  static const char *const strings[] = {"\"\"",   "\"a\"",   "\"12\"",
+                                        "\"/x\"", "\"abc\"", "\"/\""};
+  switch (depth ? rnd.below(depth > 4 ? 6 : 9) : 6 + rnd.below(3)) {
+  case 0:
+    return "null";
+  case 1:
+    return rnd.below(2) ? "true" : "false";
+  case 2:
+    return to_string(static_cast<long>(rnd.below(7)) - 3);
+  case 3:
+    return "1.5";
+  case 4:
+    return strings[rnd.below(6)];
+  case 5:
+    return "\"a\"";
+  case 6:
+  case 7: {
+    std::string s = "{";
+    std::set<std::string> used;
+    for (size_t i = 0, n = rnd.below(6); i < n; ++i) {
+      std::string key = rnd.below(3) == 0
+                            ? std::string("k") + char('a' + rnd.below(12))
+                            : keys[rnd.below(7)];
+      if (!used.insert(key).second && !repeat)
+        continue;
+      if (s.size() > 1)
+        s += ",";
+      s += "\"" + key + "\":" + random_document(rnd, repeat, depth + 1);
+    }
+    return s + "}";
+  }
+  default: {
+    std::string s = "[";
+    for (size_t i = 0, n = rnd.below(4); i < n; ++i)
+      s += (i ? "," : "") + random_document(rnd, repeat, depth + 1);
+    return s + "]";
+  }
+  }
+}
+
+static std::string outcome(bool valid,
+                           const std::vector<ValidationError> &errors) {
+  std::string s = valid ? "valid" : "invalid";
+  for (size_t i = 0; i < errors.size(); ++i)
+    s += "\n" + errors[i].path + ": " + errors[i].msg;
+  return s;
+}
+
+// Tree and compiled schema on both representations of `text`. The compact
+// one keeps every member of a repeated key, so each is compared on its own.
+template <typename Node>
+static void compare(AJsonValidator &tree, const CompiledSchema &compiled,
+                    const Node *value, const std::string &text) {
+  std::vector<ValidationError> all, errors;
+  bool valid = tree.validate(value, all);
+  std::string expected = outcome(valid, all);
+  valid = tree.validate(value);
+  CHECK_INPUT(outcome(valid, tree.getErrors()) == expected, text);
+  tree.clearErrors();
+  valid = compiled.validate(value, errors);
+  CHECK_INPUT(outcome(valid, errors) == expected, text);
+
+  ValidateOptions options;
+  for (options.maxErrors = 1; options.maxErrors <= 3; ++options.maxErrors) {
+    std::vector<ValidationError> first(
+        all.begin(), all.begin() + std::min(all.size(), options.maxErrors));
+    errors.clear();
+    valid = tree.validate(value, errors, options);
+    expected = outcome(valid, errors);
+    CHECK_INPUT(valid == all.empty() && errors.size() == first.size(), text);
+    if (!branchErrors)
+      CHECK_INPUT(expected == outcome(all.empty(), first), text);
+    errors.clear();
+    valid = compiled.validate(value, errors, options);
+    CHECK_INPUT(outcome(valid, errors) == expected, text);
+  }
+}
+
+static void compare(AJsonValidator &tree, const CompiledSchema &compiled,
+                    const std::string &text) {
+  JsonDocument compactDoc, doc;
+  compare(tree, compiled, &compactDoc.parseCompact(text), text);
+  compare(tree, compiled, static_cast<const AJsonValue *>(doc.parse(text)),
+          text);
+}
+
+// The tree keeps the position of the first of repeated keys, like the
+// handler, when it keeps the order of the text. Stopping at the first
+// error, the handler cannot know that a later value replaces the failing
+// one, so it is only held to the tree on text without repeated keys.
+static void stream(AJsonValidator &tree, SchemaHandler &handler,
+                   SchemaHandler &failFast, const std::string &text,
+                   bool repeat) {
+  ParseOptions options;
+  options.keyOrder = INSERTION_ORDER;
+  JsonDocument doc;
+  const AJsonValue *value = doc.parse(text, options);
+  bool valid = tree.validate(value);
+  std::vector<ValidationError> errors = tree.getErrors();
+  tree.clearErrors();
+
+  handler.clear();
+  CHECK_INPUT(Json::sax(text, handler), text);
+  CHECK_INPUT(outcome(handler.valid(), handler.getErrors()) ==
+                  outcome(valid, errors),
+              text);
+  if (repeat)
+    return;
+
+  failFast.clear();
+  CHECK_INPUT(Json::sax(text, failFast) == valid, text);
+  CHECK_INPUT(failFast.valid() == valid, text);
+  const std::vector<ValidationError> &some = failFast.getErrors();
+  CHECK_INPUT(valid || !some.empty(), text);
+  for (size_t i = 0; i < some.size(); ++i) {
+    bool found = false;
+    for (size_t j = 0; j < errors.size() && !found; ++j)
+      found = errors[j].path == some[i].path && errors[j].msg == some[i].msg;
+    CHECK_INPUT(found, text);
+  }
+}
+
+int main() {
+  TestRandom rnd(21);
+  for (size_t round = 0; round < 5000; ++round) {
+    branchErrors = false;
+    AJsonValidator *tree = random_schema(rnd, rnd.below(2) != 0, 0);
+    CompiledSchema compiled(*tree);
+    SchemaHandler handler(compiled), failFast(compiled, true);
+    for (size_t i = 0; i < 5; ++i) {
+      std::string text = random_document(rnd, i % 2 != 0, 0);
+      compare(*tree, compiled, text);
+      stream(*tree, handler, failFast, text, i % 2 != 0);
+    }
+    delete tree;
+  }
+
+  MappedFile config("config.json");
+  CompiledSchema server(ServerSchema);
+  branchErrors = false;
+  compare(ServerSchema, server, std::string(config.data(), config.size()));
+  return test_result("schema");
+}
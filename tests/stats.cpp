@@ -0,0 +1,79 @@
+#include "Json.hpp"
+#include "JsonDocument.hpp"
+#include "test.hpp"
+#include <string>
+
+// A ParseError locates the error by offset and by 1-based line and column,
+// the same in both engines; ParseStats counts the nodes of a parse by type
+// along with its deepest nesting.
+
+static ParseOptions with_engine(parse_engine engine) {
+  ParseOptions options;
+  options.engine = engine;
+  return options;
+}
+
+static void check_position(const std::string &input, size_t offset,
+                           size_t line, size_t column) {
+  static const parse_engine engines[] = {TOKEN_ENGINE, STRUCTURAL_ENGINE};
+  for (size_t i = 0; i < 2; ++i) {
+    try {
+      delete Json::parse_raw(input.data(), input.size(),
+                             with_engine(engines[i]));
+      CHECK_INPUT(false, input);
+    } catch (const ParseError &e) {
+      CHECK_INPUT(e.offset() == offset, input);
+      CHECK_INPUT(e.line() == line, input);
+      CHECK_INPUT(e.column() == column, input);
+    }
+  }
+}
+
+static void test_positions() {
+  check_position("[1, 2,]", 6, 1, 7);
+  check_position("{\n  \"a\": 1,\n  \"b\" 2\n}", 18, 3, 7);
+  check_position("[\r\n  true,\r\n\r\n  nul\r\n]", 16, 4, 3);
+  check_position("{\"a\": [1,\n 2]}\n}", 15, 3, 1);
+  check_position("\n\n  x", 4, 3, 3);
+}
+
+static void test_stats() {
+  const std::string input = "{\"a\": [1, 2.5, \"s\", true, null, []],\n"
+                            " \"b\": {\"c\": {\"d\": [[{}]]}}, \"e\": -3}";
+  static const parse_engine engines[] = {TOKEN_ENGINE, STRUCTURAL_ENGINE};
+  for (size_t i = 0; i < 4; ++i) {
+    ParseStats stats;
+    ParseOptions options = with_engine(engines[i % 2]);
+    options.stats = &stats;
+    JsonDocument doc;
+    AJsonValue *tree = i < 2 ? Json::parse_raw(input.data(), input.size(),
+                                               options)
+                             : doc.parse(input, options);
+    CHECK(stats.bytes == input.size());
+    CHECK(stats.nodes[OBJECT] == 4 && stats.nodes[ARRAY] == 4);
+    CHECK(stats.nodes[NUMBER] == 2 && stats.nodes[DOUBLE] == 1);
+    CHECK(stats.nodes[STRING] == 1 && stats.nodes[BOOLEAN] == 1);
+    CHECK(stats.nodes[NIL] == 1 && stats.totalNodes() == 14);
+    CHECK(stats.maxDepth == 6);
+    if (i < 2) {
+      CHECK(stats.allocations == 14);
+      delete tree;
+    } else
+      CHECK(stats.allocations == 1);
+    CHECK(stats.buildSeconds >= 0 && stats.indexSeconds >= 0);
+  }
+
+  // A flat root has depth 1.
+  ParseStats stats;
+  ParseOptions options;
+  options.stats = &stats;
+  delete Json::parse_raw("[1, 2]", 6, options);
+  CHECK(stats.maxDepth == 1 && stats.totalNodes() == 3);
+  CHECK(stats.nodes[ARRAY] == 1 && stats.nodes[NUMBER] == 2);
+}
+
+int main() {
+  test_positions();
+  test_stats();
+  return test_result("stats");
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// Minimal harness shared by the test programs: CHECK records a failure with
+// its location and carries on, test_result() is what main() returns.
+// Programs run from the top of the tree, where `make test` starts them.
+
+static int test_failures = 0;
+
+#define CHECK(cond)                                                          \
+  do {                                                                       \
+    if (!(cond)) {                                                           \
+      ++test_failures;                                                       \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+                   #cond);                                                   \
+    }                                                                        \
+  } while (0)
+
+// Same, printing the input that failed; reports at most 10 of them.
+#define CHECK_INPUT(cond, input)                                             \
+  do {                                                                       \
+    if (!(cond) && ++test_failures <= 10)                                    \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed on [%s]\n", __FILE__,    \
+                   __LINE__, #cond, std::string(input).c_str());             \
+  } while (0)
+
+inline int test_result(const char *name) {
+  std::printf("%s: %s\n", name, test_failures ? "FAILED" : "ok");
+  return test_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// Deterministic generator, so failures reproduce on every platform.
+class TestRandom {
+private:
+  unsigned long state_;
+
+public:
+  explicit TestRandom(unsigned long seed) : state_(seed) {}
+  unsigned long next() {
+    state_ = state_ * 1103515245UL + 12345UL;
+    return (state_ >> 16) & 0x7fff;
+  }
+  size_t below(size_t n) { return n ? next() % n : 0; }
+};
+
+// Mutates `s` with a few inserted, deleted or repeated pieces of JSON
+// syntax, giving a mix of valid and malformed documents.
+inline void mutate_json(std::string &s, TestRandom &rnd) {
+  static const char *const pieces[] = {
+      "{",    "}",     "[",    "]",       ":",        ",",     "\"",
+      "\\",   " ",     "\n",   "a",       "1",        "-",     ".",
+      "true", "false", "null", "\"k\"",   "\"x\\\"y\"", "0",   "e",
+      "1e5",  "E+",    "-2.5e-3", "\"\\u00e9\"", "  \"long string\"  "};
+  size_t count = rnd.below(4);
+  for (size_t m = 0; m < count; ++m) {
+    size_t pos = rnd.below(s.size() + 1);
+    switch (rnd.below(3)) {
+    case 0:
+      s.insert(pos, pieces[rnd.below(sizeof(pieces) / sizeof(*pieces))]);
+      break;
+    case 1:
+      if (pos < s.size())
+        s.erase(pos, 1 + rnd.below(3));
+      break;
+    default:
+      s.insert(pos, std::string(rnd.below(70), ' '));
+    }
+  }
+}
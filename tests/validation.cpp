@@ -0,0 +1,143 @@
+#include "CompiledSchema.hpp"
+#include "Json.hpp"
+#include "JsonValidator.hpp"
+#include "test.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Accepts arrays of even numbers, with an error for every other item. It
+// overrides the legacy validate() alone, so the schema runs it on a clone.
+class EvenItemsValidator : public AJsonValidator {
+public:
+  using AJsonValidator::validate;
+
+  bool validate(const AJsonValue *v, const std::string &path) {
+    bool valid = true;
+    for (size_t i = 0; i < v->asArray()->size(); ++i) {
+      const AJsonValue &item = (*v)[i];
+      if (!item.isNumber() || item.asNumber() % 2) {
+        addError(path + "[" + to_string(i) + "]", "odd");
+        valid = false;
+      }
+    }
+    return valid;
+  }
+  bool validate(const JsonValue *, const std::string &) { return true; }
+  AJsonValidator *clone() const { return new EvenItemsValidator(*this); }
+};
+
+// Fails with two errors, recording the most it was allowed to report.
+class LimitProbe : public AJsonValidator {
+public:
+  static size_t largest;
+
+  using AJsonValidator::validate;
+
+  bool validate(const AJsonValue *, const std::string &) { return false; }
+  bool validate(const JsonValue *, const std::string &) { return false; }
+  AJsonValidator *clone() const { return new LimitProbe(*this); }
+
+protected:
+  bool validateAt(const AJsonValue &, const SchemaPath &path,
+                  ErrorSink &errors) const {
+    largest = std::max(largest, errors.limit - errors.list.size());
+    for (size_t i = 0; i < 2 && !errors.full(); ++i)
+      errors.add(path, "probe");
+    return false;
+  }
+  bool validateAt(const JsonValue &, const SchemaPath &path,
+                  ErrorSink &errors) const {
+    return validateAt(JsonNull(), path, errors);
+  }
+};
+
+size_t LimitProbe::largest = 0;
+
+// Only the overloads taking a non-const tree fill in defaults.
+static void test_defaults() {
+  ObjectValidator schema = obj();
+  schema.property("port", num().withDefault(80))
+      .property("name", str().notEmpty());
+  AJsonValue *config = Json::parse_raw("{\"name\": \"web\"}");
+  AJsonValue *original = config->clone();
+  const AJsonValue *readOnly = config;
+  std::vector<ValidationError> errors;
+
+  CHECK(schema.validate(readOnly, errors));
+  CHECK(errors.empty());
+  CHECK(config->isEqual(*original));
+  CHECK(schema.validate(readOnly));
+  CHECK(config->isEqual(*original));
+
+  CHECK(schema.validate(config));
+  CHECK(!config->isEqual(*original));
+  CHECK((*config)["port"].asNumber() == 80);
+  delete original;
+  delete config;
+
+  // Values of matched keys get theirs too.
+  ObjectValidator sites = obj();
+  ObjectValidator site = obj();
+  site.property("on", Bool().withDefault(false));
+  sites.match(str(), site);
+  config = Json::parse_raw("{\"a\": {}, \"b\": {\"on\": true}}");
+  CHECK(sites.validate(config));
+  CHECK(!(*config)["a"]["on"].asBool() && (*config)["b"]["on"].asBool());
+  CHECK((*config)["a"]["on"].isBool());
+  delete config;
+}
+
+// A validator run on a clone still stops at the limit.
+static void test_clone_limit() {
+  ObjectValidator schema = obj();
+  schema.property("xs", EvenItemsValidator());
+  AJsonValue *v = Json::parse_raw("{\"xs\": [1, 3, 4, 5, 7]}");
+  std::vector<ValidationError> all, one;
+  ValidateOptions firstError;
+  firstError.maxErrors = 1;
+
+  CHECK(!schema.validate(v, all, "root"));
+  CHECK(all.size() == 4);
+  CHECK(!all.empty() && all[0].path == "root.xs[0]" && all[0].msg == "odd");
+  CHECK(!schema.validate(v, one, firstError, "root"));
+  CHECK(one.size() == 1);
+  CHECK(!one.empty() && one[0].path == all[0].path);
+  delete v;
+}
+
+// The errors of the branches of an OR with a message of its own are
+// dropped: one tells a branch failed, with or without a limit.
+static void test_or_message() {
+  ORValidator any = Or();
+  any.addConditions(LimitProbe()).addConditions(LimitProbe());
+  any.withMsg("neither");
+  CompiledSchema compiled(any);
+  AJsonValue *v = Json::parse_raw("[1, 2]");
+  ValidateOptions firstError;
+  firstError.maxErrors = 1;
+  ValidateOptions all;
+  const ValidateOptions *options[] = {&firstError, &all};
+
+  for (size_t i = 0; i < 2; ++i) {
+    std::vector<ValidationError> errors;
+    LimitProbe::largest = 0;
+    CHECK(!any.validate(v, errors, *options[i]));
+    CHECK(errors.size() == 1 && errors[0].msg == "neither");
+    CHECK(LimitProbe::largest == 1);
+    errors.clear();
+    LimitProbe::largest = 0;
+    CHECK(!compiled.validate(v, errors, *options[i]));
+    CHECK(errors.size() == 1 && errors[0].msg == "neither");
+    CHECK(LimitProbe::largest == 1);
+  }
+  delete v;
+}
+
+int main() {
+  test_defaults();
+  test_or_message();
+  test_clone_limit();
+  return test_result("validation");
+}
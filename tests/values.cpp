@@ -0,0 +1,23 @@
+#include "Json.hpp"
+#include "JsonTypes.hpp"
+#include "test.hpp"
+#include <stdexcept>
+
+// Lookups on a const tree.
+int main() {
+  AJsonValue *v = Json::parse_raw("{\"a\": [1, {\"b\": true}], \"c\": null}");
+  const AJsonValue &root = *v;
+  CHECK(root["a"][0].asNumber() == 1);
+  CHECK(root.at("a").at(1)["b"].isBool());
+  CHECK(root["a"][5].isNull());
+  CHECK(root["missing"].isNull());
+  bool thrown = false;
+  try {
+    root.at("a").at(2);
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  delete v;
+  return test_result("values");
+}
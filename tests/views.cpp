@@ -0,0 +1,59 @@
+#include "Json.hpp"
+#include "JsonDocument.hpp"
+#include "JsonTypes.hpp"
+#include "test.hpp"
+#include <string>
+
+// With ParseOptions::stringViews, strings without escapes are views into the
+// parsed buffer, in both engines and in a JsonDocument; escaped strings are
+// still copied, as is every string without the flag and every clone.
+
+static const std::string input =
+    "{\"plain\": \"abc\", \"escaped\": \"a\\nb\", \"unicode\": \"\\u00e9\",\n"
+    " \"list\": [\"x\", \"\", \"tab\\there\", \"long string of text\"]}";
+
+// Whether the text of `s` lies within `input`.
+static bool in_input(const JsonString &s) {
+  return s.data() >= input.data() &&
+         s.data() + s.size() <= input.data() + input.size();
+}
+
+static void check_string(const AJsonValue &value, const std::string &text,
+                         bool view) {
+  JsonString *s = value.asJsonString();
+  CHECK_INPUT(s->str() == text, text);
+  CHECK_INPUT(s->isView() == view, text);
+  CHECK_INPUT(in_input(*s) == view, text);
+  CHECK_INPUT(s->value.empty() == (view || text.empty()), text);
+  AJsonValue *copy = s->clone();
+  CHECK_INPUT(!copy->asJsonString()->isView(), text);
+  CHECK_INPUT(copy->isEqual(*s), text);
+  delete copy;
+}
+
+static void check_tree(const AJsonValue &root, bool views) {
+  check_string(root["plain"], "abc", views);
+  check_string(root["escaped"], "a\nb", false);
+  check_string(root["unicode"], "u00e9", false);
+  check_string(root["list"][0ul], "x", views);
+  check_string(root["list"][1ul], "", views);
+  check_string(root["list"][2ul], "tab\there", false);
+  check_string(root["list"][3ul], "long string of text", views);
+}
+
+int main() {
+  static const parse_engine engines[] = {TOKEN_ENGINE, STRUCTURAL_ENGINE};
+  for (size_t i = 0; i < 2; ++i)
+    for (size_t views = 0; views < 2; ++views) {
+      ParseOptions options;
+      options.engine = engines[i];
+      options.stringViews = views != 0;
+      AJsonValue *tree = Json::parse_raw(input.data(), input.size(), options);
+      check_tree(*tree, views != 0);
+      delete tree;
+
+      JsonDocument doc;
+      check_tree(*doc.parse(input.data(), input.size(), options), views != 0);
+    }
+  return test_result("views");
+}